@@ -4,7 +4,7 @@ OOPD Assignment: Student tracking system
 
 * No use of STL containers (vector/map/string). Uses C-style strings and custom data structures.
 * Demonstrates encapsulation, data hiding, polymorphism, operator overloading, and exception handling.
-* Compile: g++ -std=c++17 -O2 -Wall main.cpp -o assignment
+* Compile: g++ -std=c++17 -O2 -Wall -pthread main.cpp -o assignment
 
 Supported operations (interactive demo in main):
 
@@ -19,6 +19,23 @@ Supported operations (interactive demo in main):
 #include <cstring>
 #include <cctype>
 #include <stdexcept>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#define MARKS_SIMD_X86
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -58,6 +75,114 @@ public:
 RollNotFoundException() : StudentException("Roll number not found") {}
 };
 
+class InvalidMarkComponentException : public StudentException {
+public:
+InvalidMarkComponentException() : StudentException("Unknown marks component") {}
+};
+
+class InvalidBinWidthException : public StudentException {
+public:
+InvalidBinWidthException() : StudentException("Histogram bin width must divide the marks range") {}
+};
+
+/* -------------------------
+UTF-8 names and collation keys
+Names are stored as UTF-8. Every student carries a binary collation key,
+built once when the name is set, whose memcmp order is the name order:
+
+* primary weights, one unit per character: ASCII letters 1..26
+  (case-insensitive), space and other ASCII 27 -- i.e. chIndex + 1, so
+  ASCII names order exactly as in the trie. Latin-1 and Latin Extended-A
+  letters fold to their base letter (e -> e, e-acute -> e); any other code
+  point (Devanagari, Greek, ...) is 4 bytes, 28 then the code point
+  big-endian, which orders after Latin and by code point within a script
+* if any character carried a diacritic: a 0 separator, then one secondary
+  byte per character (0 plain, otherwise the folded letter's identity),
+  trailing zeros dropped. Pure ASCII names have no secondary part.
+------------------------- */
+
+const int COLL_KEY_MAX = 192; // 63 name bytes: <= 126 primary + 1 + 63 secondary
+const unsigned char COLL_OTHER_SCRIPT = 28;
+
+/* decode one UTF-8 sequence at s; returns its length, or 0 if malformed
+   (overlong, surrogate, out of range or truncated) */
+int utf8Decode(const char* s, int& cp) {
+unsigned char c = (unsigned char)s[0];
+if (c < 0x80) { cp = c; return 1; }
+int len;
+if (c >= 0xC2 && c <= 0xDF) { len = 2; cp = c & 0x1F; }
+else if (c >= 0xE0 && c <= 0xEF) { len = 3; cp = c & 0x0F; }
+else if (c >= 0xF0 && c <= 0xF4) { len = 4; cp = c & 0x07; }
+else return 0;
+for (int i=1;i<len;i++) {
+    unsigned char d = (unsigned char)s[i];
+    if ((d & 0xC0) != 0x80) return 0;
+    cp = (cp << 6) | (d & 0x3F);
+}
+if (len == 3 && (cp < 0x800 || (cp >= 0xD800 && cp <= 0xDFFF))) return 0;
+if (len == 4 && (cp < 0x10000 || cp > 0x10FFFF)) return 0;
+return len;
+}
+
+/* non-ASCII code points accepted as name letters: not C1 controls or
+   Latin-1 symbols, not the general punctuation block (invisible spaces), not a BOM */
+inline bool isValidNameCodepoint(int cp) {
+if (cp < 0xC0 || cp == 0xD7 || cp == 0xF7) return false;
+if (cp >= 0x2000 && cp <= 0x206F) return false;
+return cp != 0xFEFF;
+}
+
+/* base letter for U+00C0..U+017F, '_' if not a letter */
+const char* LATIN_FOLD =
+    "aaaaaaaceeeeiiiidnooooo_ouuuuyts"  // U+00C0
+    "aaaaaaaceeeeiiiidnooooo_ouuuuyty"  // U+00E0
+    "aaaaaaccccccccddddeeeeeeeeeegggg"  // U+0100
+    "gggghhhhiiiiiiiiiiiijjkkklllllll"  // U+0120
+    "lllnnnnnnnnnoooooooorrrrrrssssss"  // U+0140
+    "ssttttttuuuuuuuuuuuuwwyyyzzzzzzs";  // U+0160
+
+/* write the collation key of a UTF-8 name into key (COLL_KEY_MAX bytes); returns its length */
+int buildCollationKey(const char* name, unsigned char* key) {
+unsigned char secondary[COLL_KEY_MAX];
+int len = 0, chars = 0, lastAccent = 0;
+for (const char* p = name; *p; ) {
+    int cp;
+    int n = utf8Decode(p, cp);
+    if (n == 0) { cp = ' '; n = 1; } // stray byte: collate like chIndex does
+    p += n;
+    unsigned char sec = 0;
+    if (cp >= 0xC0 && cp <= 0x17F && LATIN_FOLD[cp - 0xC0] != '_') {
+        sec = (unsigned char)(cp - 0xC0 + 1);
+        cp = LATIN_FOLD[cp - 0xC0];
+    }
+    if (cp < 0x80) {
+        if (len + 1 > COLL_KEY_MAX) break;
+        int c = tolower(cp); // chIndex + 1, which is defined with the sort keys
+        key[len++] = (unsigned char)(c >= 'a' && c <= 'z' ? c - 'a' + 1 : 27);
+    } else {
+        if (len + 4 > COLL_KEY_MAX) break;
+        key[len++] = COLL_OTHER_SCRIPT;
+        key[len++] = (unsigned char)(cp >> 16);
+        key[len++] = (unsigned char)(cp >> 8);
+        key[len++] = (unsigned char)cp;
+    }
+    secondary[chars++] = sec;
+    if (sec) lastAccent = chars;
+}
+if (lastAccent && len + 1 + lastAccent <= COLL_KEY_MAX) {
+    key[len++] = 0;
+    memcpy(key + len, secondary, lastAccent);
+    len += lastAccent;
+}
+return len;
+}
+
+/* memcmp order on keys, a prefix first */
+inline int cmpCollationKeys(const unsigned char* a, int alen, const unsigned char* b, int blen) {
+int c = memcmp(a, b, alen < blen ? alen : blen);
+return c ? c : alen - blen;
+}
+
 /* -------------------------
 Helper functions (C-style)
 ------------------------- */
@@ -77,50 +202,31 @@ if (len >= maxlen) throw BufferOverflowException();
 strcpy(dst, src);
 }
 
-/* validate name: require at least two words (first + second) and no digits in second name */
+/* validate name: require at least two words (first + second) and no digits in second name.
+   Non-ASCII letters are accepted as well-formed UTF-8. */
 void validateName(const char* name) {
 if (!name || strlen(name) == 0) throw NoSecondNameException();
 int n = strlen(name);
 int words = 0;
 bool inword = false;
-int lastWordStart = -1;
-for (int i=0;i<n;i++) {
-char c = name[i];
-if (!isValidNameChar(c)) throw InvalidSecondNameException();
-if (!isspace((unsigned char)c) && !inword) {
-inword = true;
-lastWordStart = i;
-words++;
-} else if (isspace((unsigned char)c)) {
-inword = false;
-}
-}
-if (words < 2) throw NoSecondNameException();
-
-// check second word doesn't contain digits or special chars
-// find second word start
-int wordCount = 0;
-inword = false;
-int wordStart = -1;
-for (int i=0;i<n;i++) {
-    char c = name[i];
-    if (!isspace((unsigned char)c) && !inword) {
+for (int i=0;i<n;) {
+    int cp;
+    int len = utf8Decode(name + i, cp);
+    if (len == 0) throw InvalidSecondNameException();
+    if (len == 1 ? !isValidNameChar(name[i]) : !isValidNameCodepoint(cp)) throw InvalidSecondNameException();
+    bool space = len == 1 && isspace((unsigned char)name[i]);
+    if (!space && !inword) {
         inword = true;
-        wordCount++;
-        wordStart = i;
-        if (wordCount==2) {
-            // validate until end of this word
-            int j = i;
-            while (j < n && !isspace((unsigned char)name[j])) {
-                if (!isalpha((unsigned char)name[j]) && name[j] != '-' ) throw InvalidSecondNameException();
-                j++;
-            }
-            break;
-        }
-    } else if (isspace((unsigned char)c)) {
+        words++;
+    } else if (space) {
         inword = false;
     }
+    // second word: letters and '-' only
+    if (words == 2 && inword && len == 1 && !isalpha((unsigned char)name[i]) && name[i] != '-')
+        throw InvalidSecondNameException();
+    i += len;
 }
+if (words < 2) throw NoSecondNameException();
 }
 
 /* validate roll */
@@ -131,6 +237,125 @@ if (!isValidRollChar(roll[i])) throw InvalidRollException();
 }
 }
 
+/* -------------------------
+Memory accounting
+Process-wide byte/object counters per subsystem, with high-water marks.
+Classes that own memory report through class-level operator new/delete or
+the memNewArray/memDeleteArray helpers; memStats() reads the counters at
+runtime. Counters are atomic so concurrent builders can share them.
+------------------------- */
+
+enum MemSubsystem {
+MEM_NODES=0,     // Course list nodes
+MEM_STUDENTS,    // Student objects
+MEM_EXPORT,      // exportArray / sorted result arrays handed to callers
+MEM_TRIE_NODES,  // NameTrie nodes
+MEM_TRIE_ARRAYS, // student chains in the trie
+MEM_INDEX,       // slot map and other roll indexes
+MEM_FILTER,      // roll Bloom filter
+MEM_VIEWS,       // cached sorted views
+MEM_SORT,        // sort scratch buffers and keys
+MEM_SNAPSHOT,    // published snapshot versions and retire lists
+MEM_HISTORY,     // old marks versions
+MEM_COLUMNS,     // dense marks columns for aggregate kernels
+MEM_SKETCH,      // quantile sketches
+MEM_RECORDS,     // RecordReader/RecordWriter blocks
+MEM_COUNT
+};
+
+const char* memSubsystemName(MemSubsystem m) {
+static const char* names[MEM_COUNT] = {
+    "nodes", "students", "export", "trie-nodes", "trie-arrays", "index", "filter", "views", "sort", "snapshot", "history", "columns", "sketch", "records"
+};
+return names[m];
+}
+
+struct MemCounter {
+std::atomic<long long> bytes;
+std::atomic<long long> objects;
+std::atomic<long long> peakBytes;
+std::atomic<long long> allocations; // cumulative
+};
+
+MemCounter memCounters[MEM_COUNT];
+std::atomic<long long> memTotalBytes(0);
+std::atomic<long long> memTotalPeak(0);
+
+inline void memRaisePeak(std::atomic<long long>& peak, long long v) {
+long long p = peak.load(std::memory_order_relaxed);
+while (v > p && !peak.compare_exchange_weak(p, v, std::memory_order_relaxed)) {}
+}
+
+inline void memAlloc(MemSubsystem m, size_t bytes, long long objs=1) {
+MemCounter& c = memCounters[m];
+long long now = c.bytes.fetch_add((long long)bytes, std::memory_order_relaxed) + (long long)bytes;
+c.objects.fetch_add(objs, std::memory_order_relaxed);
+c.allocations.fetch_add(1, std::memory_order_relaxed);
+memRaisePeak(c.peakBytes, now);
+memRaisePeak(memTotalPeak, memTotalBytes.fetch_add((long long)bytes, std::memory_order_relaxed) + (long long)bytes);
+}
+
+inline void memFree(MemSubsystem m, size_t bytes, long long objs=1) {
+memCounters[m].bytes.fetch_sub((long long)bytes, std::memory_order_relaxed);
+memCounters[m].objects.fetch_sub(objs, std::memory_order_relaxed);
+memTotalBytes.fetch_sub((long long)bytes, std::memory_order_relaxed);
+}
+
+/* counted array allocation; free with memDeleteArray and the same n */
+template<class T> T* memNewArray(MemSubsystem m, size_t n) {
+T* p = new T[n];
+memAlloc(m, n*sizeof(T));
+return p;
+}
+template<class T> void memDeleteArray(MemSubsystem m, T* p, size_t n) {
+if (!p) return;
+memFree(m, n*sizeof(T));
+delete [] p;
+}
+
+struct MemUsage {
+long long bytes;
+long long objects;
+long long peakBytes;
+long long allocations;
+};
+
+struct MemStats {
+MemUsage sub[MEM_COUNT];
+long long totalBytes;
+long long peakBytes;
+};
+
+MemStats memStats() {
+MemStats st;
+for (int i=0;i<MEM_COUNT;i++) {
+    st.sub[i].bytes = memCounters[i].bytes.load(std::memory_order_relaxed);
+    st.sub[i].objects = memCounters[i].objects.load(std::memory_order_relaxed);
+    st.sub[i].peakBytes = memCounters[i].peakBytes.load(std::memory_order_relaxed);
+    st.sub[i].allocations = memCounters[i].allocations.load(std::memory_order_relaxed);
+}
+st.totalBytes = memTotalBytes.load(std::memory_order_relaxed);
+st.peakBytes = memTotalPeak.load(std::memory_order_relaxed);
+return st;
+}
+
+void printMemStats() {
+MemStats st = memStats();
+for (int i=0;i<MEM_COUNT;i++) {
+    if (st.sub[i].allocations == 0) continue;
+    cout << "  " << memSubsystemName((MemSubsystem)i) << ": " << st.sub[i].bytes << " B in "
+         << st.sub[i].objects << " objects (peak " << st.sub[i].peakBytes << " B)\n";
+}
+cout << "  total: " << st.totalBytes << " B (peak " << st.peakBytes << " B)\n";
+}
+
+class Student;
+
+/* free an array returned by Course::exportArray or a sortBy* helper */
+void releaseStudentArray(Student** arr, int n) {
+memDeleteArray(MEM_EXPORT, arr, n);
+}
+
 /* -------------------------
 Marks and student classes
 ------------------------- */
@@ -140,6 +365,9 @@ const char* branchToStr(Branch b) { return b==BR_CSE ? "CSE" : "ECE"; }
 const int NAME_MAX = 64;
 const int ROLL_MAX = 32;
 
+enum MarkComponent : int { MC_ASSIGN=0, MC_MID=1, MC_LAB=2, MC_FINAL=3 }; // fixed type: out-of-range values stay checkable
+const int MC_COUNT = 4;
+
 struct Marks {
 // components: assignment, midterm, lab, final
 double assignment;
@@ -152,45 +380,104 @@ double total() const {
     return assignment + midterm + lab + finalexam;
 }
 
+// component by enum (for batched and generic access)
+double& at(MarkComponent mc) {
+    switch(mc) {
+    case MC_ASSIGN: return assignment;
+    case MC_MID: return midterm;
+    case MC_LAB: return lab;
+    case MC_FINAL: return finalexam;
+    }
+    return assignment;
+}
+double at(MarkComponent mc) const { return const_cast<Marks*>(this)->at(mc); }
+
+};
+
+/* fields a container may need to hear about when they change */
+enum StudentField { SF_NAME=0, SF_ROLL=1, SF_BRANCH=2, SF_LEVEL=3, SF_MARKS=4 };
+
+/* Observer notified around changes to a student owned by a container
+   (Course keeps its indexes in sync through this). studentChanging() runs
+   while the old value is still visible, studentChanged() after the update. */
+class StudentObserver {
+public:
+virtual ~StudentObserver() {}
+virtual void studentChanging(Student* s, StudentField f) = 0;
+virtual void studentChanged(Student* s, StudentField f) = 0;
 };
 
 /* Abstract base class Student */
 class Student {
 protected:
-char name[NAME_MAX];
+char name[NAME_MAX];  // UTF-8
 char roll[ROLL_MAX];
+unsigned char collKey[COLL_KEY_MAX]; // collation key of name
+int collKeyLen;
 Branch branch;
 Marks marks;
 int level; // 0 BTech, 1 MTech, 2 PhD
+StudentObserver* observer; // owning container, if any
+int ownerSlot;             // slot in the owning Course, -1 if not owned
+friend class Course;       // batched mark updates write in place
+
+void changing(StudentField f) { if (observer) observer->studentChanging(this, f); }
+void changed(StudentField f) { if (observer) observer->studentChanged(this, f); }
+
 public:
 Student() {
 name[0]='\0';
 roll[0]='\0';
+collKeyLen = 0;
 branch = BR_CSE;
 level = 0;
+observer = nullptr;
+ownerSlot = -1;
 }
 virtual ~Student() {}
+
+// counted allocation (sized delete sees the most-derived size)
+static void* operator new(size_t sz) { memAlloc(MEM_STUDENTS, sz); return ::operator new(sz); }
+static void operator delete(void* p, size_t sz) { memFree(MEM_STUDENTS, sz); ::operator delete(p); }
+
+void setObserver(StudentObserver* o) { observer = o; }
+
 // Data hiding: provide setters/getters
+// (validate into a scratch buffer first so observers never see a failed update)
 void setName(const char* nm) {
 validateName(nm);
-safeStrCpy(name, nm, NAME_MAX);
+char tmp[NAME_MAX];
+safeStrCpy(tmp, nm, NAME_MAX);
+unsigned char key[COLL_KEY_MAX];
+int klen = buildCollationKey(tmp, key);
+changing(SF_NAME);
+strcpy(name, tmp);
+memcpy(collKey, key, klen);
+collKeyLen = klen;
+changed(SF_NAME);
 }
 const char* getName() const { return name; }
+const unsigned char* collationKey() const { return collKey; }
+int collationKeyLen() const { return collKeyLen; }
 
 void setRoll(const char* r) {
     validateRoll(r);
-    safeStrCpy(roll, r, ROLL_MAX);
+    char tmp[ROLL_MAX];
+    safeStrCpy(tmp, r, ROLL_MAX);
+    changing(SF_ROLL);
+    strcpy(roll, tmp);
+    changed(SF_ROLL);
 }
 const char* getRoll() const { return roll; }
 
-void setBranch(Branch b) { branch = b; }
+void setBranch(Branch b) { changing(SF_BRANCH); branch = b; changed(SF_BRANCH); }
 Branch getBranch() const { return branch; }
 
-void setLevel(int lv) { level = lv; }
+void setLevel(int lv) { changing(SF_LEVEL); level = lv; changed(SF_LEVEL); }
 int getLevel() const { return level; }
 
-void setMarks(const Marks& m) { marks = m; }
-Marks getMarks() const { return marks; }
+void setMarks(const Marks& m) { changing(SF_MARKS); marks = m; changed(SF_MARKS); }
+const Marks& getMarks() const { return marks; }
 
 double totalMarks() const { return marks.total(); }
 
@@ -227,285 +514,4626 @@ const char* type() const override { return "PhD"; }
 };
 
 /* -------------------------
-Storage: singly linked list of students
-operator overloading:
-Course += Student*  (adds a student - Course takes ownership)
-Course(roll) -> returns pointer to Student for modification (throws if not found)
+Sort keys and comparators
+Shared by Course's cached views and the sorting utilities below.
+SK_NAME compares collation keys; for ASCII names that is chIndex order
+(case-insensitive, non-letters fold to space), the order the name trie
+produces. cmpNames and the trie work on raw bytes.
+------------------------- */
+
+enum SortKey { SK_ROLL=0, SK_NAME=1, SK_ASSIGN=2, SK_MID=3, SK_LAB=4, SK_FINAL=5, SK_TOTAL=6 };
+const int SK_COUNT = 7;
+
+inline SortKey componentKey(MarkComponent mc) { return (SortKey)(SK_ASSIGN + mc); }
+
+const int TRIE_ALPHABET = 27; // 'a'..'z' + space as 26
+inline int chIndex(char c) {
+if (c == ' ') return 26;
+c = tolower((unsigned char)c);
+if (c >= 'a' && c <= 'z') return c - 'a';
+return 26; // map anything else to space (safe)
+}
+
+/* compare names in trie order: chIndex per character, a prefix sorts first */
+int cmpNames(const char* a, const char* b) {
+while (*a && *b) {
+    int d = chIndex(*a) - chIndex(*b);
+    if (d) return d;
+    a++; b++;
+}
+return (*a != 0) - (*b != 0);
+}
+
+/* name order on precomputed collation keys (UTF-8 aware) */
+inline int cmpCollation(const Student* a, const Student* b) {
+return cmpCollationKeys(a->collationKey(), a->collationKeyLen(), b->collationKey(), b->collationKeyLen());
+}
+
+inline int cmpDouble(double a, double b) { return (a < b) ? -1 : (a > b) ? 1 : 0; }
+
+/* compare on the key only (equal keys compare 0) */
+int compareKey(const Student* a, const Student* b, SortKey k) {
+switch(k) {
+case SK_ROLL: return strcmp(a->getRoll(), b->getRoll());
+case SK_NAME: return cmpCollation(a, b);
+case SK_TOTAL: return cmpDouble(a->totalMarks(), b->totalMarks());
+default: return cmpDouble(a->getMarks().at((MarkComponent)(k - SK_ASSIGN)),
+                          b->getMarks().at((MarkComponent)(k - SK_ASSIGN)));
+}
+}
+
+/* total order: key, then roll as tie-breaker (rolls are unique within a course) */
+int compareKeyThenRoll(const Student* a, const Student* b, SortKey k) {
+int c = compareKey(a, b, k);
+if (c || k == SK_ROLL) return c;
+return strcmp(a->getRoll(), b->getRoll());
+}
+
+/* quicksort on any key with the roll tie-breaker */
+void quickSortByKey(Student** arr, int lo, int hi, SortKey k) {
+if (lo >= hi) return;
+Student* pivot = arr[(lo+hi)/2];
+int i = lo, j = hi;
+while (i <= j) {
+    while (compareKeyThenRoll(arr[i], pivot, k) < 0) i++;
+    while (compareKeyThenRoll(arr[j], pivot, k) > 0) j--;
+    if (i <= j) {
+        Student* t = arr[i]; arr[i]=arr[j]; arr[j]=t;
+        i++; j--;
+    }
+}
+if (lo < j) quickSortByKey(arr, lo, j, k);
+if (i < hi) quickSortByKey(arr, i, hi, k);
+}
+
+/* -------------------------
+Student records
+Plain copy of a student: the on-disk archive format and the immutable
+payload of snapshot reads.
+------------------------- */
+
+/* on-disk layout of one student */
+struct StudentRecord {
+char name[NAME_MAX];
+char roll[ROLL_MAX];
+int branch;
+int level;
+Marks marks;
+};
+
+void toRecord(const Student* s, StudentRecord& r) {
+r = StudentRecord();
+strcpy(r.name, s->getName());
+strcpy(r.roll, s->getRoll());
+r.branch = (int)s->getBranch();
+r.level = s->getLevel();
+r.marks = s->getMarks();
+}
+
+/* Student loaded from a record (level decides type()); not owned by a Course.
+   Records are trusted: fields are copied without re-validation. */
+class ArchivedStudent : public Student {
+public:
+void load(const StudentRecord& r) {
+    memcpy(name, r.name, NAME_MAX); name[NAME_MAX-1] = '\0';
+    collKeyLen = buildCollationKey(name, collKey);
+    memcpy(roll, r.roll, ROLL_MAX); roll[ROLL_MAX-1] = '\0';
+    branch = (Branch)r.branch;
+    level = r.level;
+    marks = r.marks;
+}
+const char* type() const override {
+    return level == 0 ? "BTech" : level == 1 ? "MTech" : "PhD";
+}
+};
+
+void printRecord(const StudentRecord& r) {
+ArchivedStudent s;
+s.load(r);
+s.print();
+}
+
+/* -------------------------
+Snapshot reads (epoch-based reclamation)
+In snapshot mode a Course publishes an immutable copy of its roster after
+every mutation: a root array of fixed-size chunks, each chunk an array of
+pointers to immutable StudentRecords indexed by slot. A write copies only the
+record it changes, the chunk holding it and the root (copy-on-write at record
+level), then swaps the root atomically. Readers pin an epoch, load the root
+and traverse it without locks; replaced objects are retired and freed once
+no pinned reader can still reach them. Writers still run one at a time.
 ------------------------- */
 
-class Course {
+const int SNAP_CHUNK = 64;      // slots per chunk
+const int SNAP_READERS = 128;   // concurrently pinned reader threads
+
+struct RosterChunk {
+const StudentRecord* recs[SNAP_CHUNK];
+};
+
+struct RosterVersion {
+RosterChunk** chunks;
+int nchunks;
+int count;                    // live records
+unsigned long long version;   // Course mutation counter at publish time
+};
+
+class EpochManager {
 private:
-struct Node {
-Student* student;
-Node* next;
-Node(Student* s=nullptr): student(s), next(nullptr) {}
+struct alignas(64) ReaderSlot {
+std::atomic<unsigned long long> epoch; // 0 = not reading
+std::atomic<bool> used;
+};
+struct Retired {
+void* p;
+void (*del)(void*);
+unsigned long long epoch;
+};
+ReaderSlot readers[SNAP_READERS];
+std::atomic<unsigned long long> global;
+std::mutex lock;   // protects the retire list
+Retired* retired;
+int nretired, retiredCap;
+
+// per-thread reader slot, released when the thread exits
+struct ThreadSlot {
+EpochManager* mgr;
+int idx;
+int depth;
+ThreadSlot(): mgr(nullptr), idx(-1), depth(0) {}
+~ThreadSlot() { if (mgr && idx >= 0) mgr->readers[idx].used.store(false); }
+};
+static ThreadSlot& threadSlot() {
+    static thread_local ThreadSlot ts;
+    return ts;
+}
+
+EpochManager(): global(1), retired(nullptr), nretired(0), retiredCap(0) {
+    for (int i=0;i<SNAP_READERS;i++) { readers[i].epoch.store(0); readers[i].used.store(false); }
+}
+
+public:
+static EpochManager& instance() {
+    static EpochManager mgr;
+    return mgr;
+}
+
+// pin the current epoch for this thread (nests)
+void enter() {
+    ThreadSlot& ts = threadSlot();
+    if (ts.idx < 0) {
+        for (int i=0;i<SNAP_READERS && ts.idx < 0;i++) {
+            bool expect = false;
+            if (readers[i].used.compare_exchange_strong(expect, true)) ts.idx = i;
+        }
+        if (ts.idx < 0) throw StudentException("Too many concurrent snapshot readers");
+        ts.mgr = this;
+    }
+    if (ts.depth++ == 0) readers[ts.idx].epoch.store(global.load()); // seq_cst: announce before loading roots
+}
+
+void exit() {
+    ThreadSlot& ts = threadSlot();
+    if (--ts.depth == 0) readers[ts.idx].epoch.store(0, std::memory_order_release);
+}
+
+// free p with del once every reader pinned now has left
+void retire(void* p, void (*del)(void*)) {
+    std::lock_guard<std::mutex> g(lock);
+    if (nretired == retiredCap) {
+        int newcap = retiredCap ? retiredCap*2 : 64;
+        Retired* tmp = memNewArray<Retired>(MEM_SNAPSHOT, newcap);
+        for (int i=0;i<nretired;i++) tmp[i] = retired[i];
+        memDeleteArray(MEM_SNAPSHOT, retired, retiredCap);
+        retired = tmp;
+        retiredCap = newcap;
+    }
+    retired[nretired].p = p;
+    retired[nretired].del = del;
+    retired[nretired].epoch = global.load();
+    nretired++;
+}
+
+// advance the epoch and free whatever no reader can reach any more
+void reclaim() {
+    global.fetch_add(1);
+    unsigned long long minActive = ~0ULL;
+    for (int i=0;i<SNAP_READERS;i++) {
+        unsigned long long e = readers[i].epoch.load();
+        if (e && e < minActive) minActive = e;
+    }
+    std::lock_guard<std::mutex> g(lock);
+    int w = 0;
+    for (int i=0;i<nretired;i++) {
+        if (retired[i].epoch < minActive) retired[i].del(retired[i].p);
+        else retired[w++] = retired[i];
+    }
+    nretired = w;
+}
+
+int pending() {
+    std::lock_guard<std::mutex> g(lock);
+    return nretired;
+}
+
+// start a new epoch and return it
+unsigned long long advance() { return global.fetch_add(1) + 1; }
+
+// true once no reader pinned before epoch e is still pinned
+bool quiescent(unsigned long long e) {
+    for (int i=0;i<SNAP_READERS;i++) {
+        unsigned long long r = readers[i].epoch.load();
+        if (r && r < e) return false;
+    }
+    return true;
+}
+
+};
+
+/* pins the calling thread's epoch for its lifetime (create and destroy it on
+   the same thread) */
+class EpochGuard {
+private:
+EpochGuard(const EpochGuard&) = delete;
+EpochGuard& operator=(const EpochGuard&) = delete;
+public:
+EpochGuard() { EpochManager::instance().enter(); }
+~EpochGuard() { EpochManager::instance().exit(); }
+};
+
+void deleteRecord(void* p) { memDeleteArray(MEM_SNAPSHOT, (StudentRecord*)p, 1); }
+void deleteChunk(void* p) { memDeleteArray(MEM_SNAPSHOT, (RosterChunk*)p, 1); }
+void deleteRoster(void* p) {
+RosterVersion* r = (RosterVersion*)p;
+memDeleteArray(MEM_SNAPSHOT, r->chunks, r->nchunks);
+memDeleteArray(MEM_SNAPSHOT, r, 1);
+}
+
+/* Builds the next RosterVersion from the published one. Chunks are copied on
+   first write; replaced records, chunks and the old root are retired when the
+   new root is published. */
+class RosterPublisher {
+private:
+std::atomic<RosterVersion*> root;
+RosterVersion* work;      // pending version, nullptr outside begin/commit
+RosterVersion* base;      // version work was copied from
+
+static RosterVersion* newRoster(int nchunks) {
+    RosterVersion* r = memNewArray<RosterVersion>(MEM_SNAPSHOT, 1);
+    r->nchunks = nchunks;
+    r->chunks = memNewArray<RosterChunk*>(MEM_SNAPSHOT, nchunks);
+    for (int i=0;i<nchunks;i++) r->chunks[i] = nullptr;
+    r->count = 0;
+    r->version = 0;
+    return r;
+}
+
+public:
+RosterPublisher(): root(nullptr), work(nullptr), base(nullptr) {
+    root.store(newRoster(0));
+}
+~RosterPublisher() {
+    // no readers may be pinned on a publisher being destroyed
+    RosterVersion* r = root.load();
+    for (int c=0;c<r->nchunks;c++) {
+        if (!r->chunks[c]) continue;
+        for (int i=0;i<SNAP_CHUNK;i++) if (r->chunks[c]->recs[i]) deleteRecord((void*)r->chunks[c]->recs[i]);
+        deleteChunk(r->chunks[c]);
+    }
+    deleteRoster(r);
+}
+
+const RosterVersion* load() const { return root.load(std::memory_order_acquire); }
+
+void begin() {
+    if (work) return;
+    base = root.load(std::memory_order_relaxed);
+    work = newRoster(base->nchunks);
+    for (int c=0;c<base->nchunks;c++) work->chunks[c] = base->chunks[c];
+    work->count = base->count;
+}
+
+// set slot to a copy of s (or empty when s is null)
+void set(int slot, const Student* s) {
+    begin();
+    int c = slot / SNAP_CHUNK, off = slot % SNAP_CHUNK;
+    if (c >= work->nchunks) {
+        int nc = c+1 > 2*work->nchunks ? c+1 : 2*work->nchunks;
+        RosterChunk** tmp = memNewArray<RosterChunk*>(MEM_SNAPSHOT, nc);
+        for (int i=0;i<nc;i++) tmp[i] = i < work->nchunks ? work->chunks[i] : nullptr;
+        memDeleteArray(MEM_SNAPSHOT, work->chunks, work->nchunks);
+        work->chunks = tmp;
+        work->nchunks = nc;
+    }
+    RosterChunk* ch = work->chunks[c];
+    if (!ch || (c < base->nchunks && ch == base->chunks[c])) {
+        RosterChunk* copy = memNewArray<RosterChunk>(MEM_SNAPSHOT, 1);
+        for (int i=0;i<SNAP_CHUNK;i++) copy->recs[i] = ch ? ch->recs[i] : nullptr;
+        if (ch) EpochManager::instance().retire(ch, deleteChunk);
+        work->chunks[c] = ch = copy;
+    }
+    if (ch->recs[off]) {
+        EpochManager::instance().retire((void*)ch->recs[off], deleteRecord);
+        work->count--;
+    }
+    ch->recs[off] = nullptr;
+    if (s) {
+        StudentRecord* r = memNewArray<StudentRecord>(MEM_SNAPSHOT, 1);
+        toRecord(s, *r);
+        ch->recs[off] = r;
+        work->count++;
+    }
+}
+
+// publish the pending version
+void commit(unsigned long long version) {
+    if (!work) return;
+    work->version = version;
+    root.store(work, std::memory_order_release);
+    EpochManager::instance().retire(base, deleteRoster);
+    work = base = nullptr;
+    EpochManager::instance().reclaim();
+}
+
+};
+
+/* RAII reader: pins an epoch and sees one consistent published roster */
+class SnapshotReader {
+private:
+const RosterVersion* v;
+SnapshotReader(const SnapshotReader&) = delete;
+SnapshotReader& operator=(const SnapshotReader&) = delete;
+public:
+explicit SnapshotReader(const RosterPublisher& p) {
+    EpochManager::instance().enter();
+    v = p.load();
+}
+~SnapshotReader() { EpochManager::instance().exit(); }
+
+int size() const { return v->count; }
+unsigned long long version() const { return v->version; }
+
+// call fn(const StudentRecord&) for every record, in slot order
+template<class Fn> void forEach(Fn fn) const {
+    for (int c=0;c<v->nchunks;c++) {
+        const RosterChunk* ch = v->chunks[c];
+        if (!ch) continue;
+        for (int i=0;i<SNAP_CHUNK;i++) if (ch->recs[i]) fn(*ch->recs[i]);
+    }
+}
+
+const StudentRecord* find(const char* roll) const {
+    for (int c=0;c<v->nchunks;c++) {
+        const RosterChunk* ch = v->chunks[c];
+        if (!ch) continue;
+        for (int i=0;i<SNAP_CHUNK;i++) {
+            if (ch->recs[i] && strcmp(ch->recs[i]->roll, roll) == 0) return ch->recs[i];
+        }
+    }
+    return nullptr;
+}
+};
+
+/* -------------------------
+Marks history (multi-version marks)
+With history enabled, each setMarks/batch update pushes the marks it replaces
+onto a per-student version chain, newest first, tagged with the interval in
+which they were current. Course::asOf(ts)(roll) answers "what were the marks
+at ts". The current marks stay in the Student, so normal reads are unchanged.
+Versions that stopped being current more than the retention window ago are
+dropped by collectHistory(), optionally from a background thread.
+------------------------- */
+
+typedef long long Timestamp; // microseconds since the Unix epoch
+
+Timestamp systemMicros() {
+return (Timestamp)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+struct MarksVersion {
+Marks marks;
+Timestamp validFrom;  // inclusive
+Timestamp validTo;    // exclusive
+MarksVersion* older;
+};
+
+void freeHistory(MarksVersion* v) {
+while (v) {
+    MarksVersion* o = v->older;
+    memDeleteArray(MEM_HISTORY, v, 1);
+    v = o;
+}
+}
+
+/* -------------------------
+Counting Bloom filter over roll numbers
+Answers "definitely absent" without touching the student list, so lookups of
+stale/unknown rolls skip the scan before RollNotFoundException is thrown.
+8-bit counters allow removal; a counter that saturates at 255 is never
+decremented again (it just stays "maybe present").
+------------------------- */
+
+unsigned long long hashRoll(const char* s) {
+// 64-bit FNV-1a
+unsigned long long h = 1469598103934665603ULL;
+while (*s) {
+    h ^= (unsigned char)*s++;
+    h *= 1099511628211ULL;
+}
+return h;
+}
+
+inline unsigned long long mix64(unsigned long long x) {
+// splitmix64 finaliser, used to derive the second hash
+x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+x ^= x >> 31;
+return x;
+}
+
+class RollBloomFilter {
+private:
+unsigned char* counters;
+unsigned mask;   // counter count - 1 (power of two)
+int hashes;
+int items;
+
+RollBloomFilter(const RollBloomFilter&) = delete;
+RollBloomFilter& operator=(const RollBloomFilter&) = delete;
+
+public:
+// observed query outcomes (see Course::stats)
+long long queries;
+long long negatives;       // answered "definitely absent"
+long long falsePositives;  // said "maybe", but the scan found nothing
+
+// numCounters is rounded up to a power of two
+RollBloomFilter(int numCounters, int numHashes) {
+    unsigned m = 64;
+    while ((int)m < numCounters) m <<= 1;
+    counters = memNewArray<unsigned char>(MEM_FILTER, m);
+    memset(counters, 0, m);
+    mask = m - 1;
+    hashes = numHashes < 1 ? 1 : numHashes;
+    items = 0;
+    queries = negatives = falsePositives = 0;
+}
+~RollBloomFilter() { memDeleteArray(MEM_FILTER, counters, mask+1); }
+
+void add(const char* roll) {
+    unsigned long long h1 = hashRoll(roll), h2 = mix64(h1) | 1;
+    for (int i=0;i<hashes;i++) {
+        unsigned char& c = counters[(h1 + i*h2) & mask];
+        if (c < 255) c++;
+    }
+    items++;
+}
+
+void remove(const char* roll) {
+    unsigned long long h1 = hashRoll(roll), h2 = mix64(h1) | 1;
+    for (int i=0;i<hashes;i++) {
+        unsigned char& c = counters[(h1 + i*h2) & mask];
+        if (c > 0 && c < 255) c--;
+    }
+    items--;
+}
+
+bool mayContain(const char* roll) const {
+    unsigned long long h1 = hashRoll(roll), h2 = mix64(h1) | 1;
+    for (int i=0;i<hashes;i++) {
+        if (counters[(h1 + i*h2) & mask] == 0) return false;
+    }
+    return true;
+}
+
+int numCounters() const { return (int)mask + 1; }
+int numHashes() const { return hashes; }
+
+// theoretical false-positive rate for the current load: (1 - e^(-kn/m))^k
+double estimatedFpr() const {
+    double m = (double)mask + 1;
+    return pow(1.0 - exp(-(double)hashes * items / m), hashes);
+}
+
+// fraction of absent rolls that got through the filter
+double observedFpr() const {
+    long long absent = negatives + falsePositives;
+    return absent ? (double)falsePositives / absent : 0.0;
+}
+
+};
+
+/* -------------------------
+B+tree index on roll
+Ordered index kept in sync by Course: O(log n) point lookups, range and
+prefix scans, and a roll-ordered walk along the leaf chain.
+
+* fanout 8: a node's eight key heads fill exactly one 64-byte cache line, so
+  the search within a node touches one line in the common case
+* prefix compression: a node stores the length of the prefix shared by all
+  its keys, and each head holds the next 8 key bytes after that prefix
+  (big-endian, so heads compare like the strings); full strings are only
+  compared when two heads tie
+* entries are (roll, Student address) so duplicate rolls stay distinct
+* deletes are lazy: nodes are not rebalanced, empty nodes are unlinked
+------------------------- */
+
+const int BPT_FANOUT = 8;
+
+struct alignas(64) BptNode {
+unsigned long long heads[BPT_FANOUT]; // key bytes [prefixLen, prefixLen+8)
+const char* keys[BPT_FANOUT];         // leaf: the student's roll; internal: owned copy
+unsigned long long ties[BPT_FANOUT];  // Student address, breaks roll ties
+Student* vals[BPT_FANOUT];            // leaf only
+BptNode* kids[BPT_FANOUT+1];          // internal only
+BptNode* prev;                        // leaf chain
+BptNode* next;
+int n;
+int prefixLen;
+bool leaf;
+};
+
+class RollIndex;
+
+/* forward iterator over a roll range; invalidated by any index mutation */
+class RollRange {
+private:
+const BptNode* leaf;
+int pos;
+char hi[ROLL_MAX];
+int prefixLen;   // > 0: prefix scan (hi holds the prefix)
+bool bounded;
+friend class RollIndex;
+public:
+RollRange(): leaf(nullptr), pos(0), prefixLen(0), bounded(false) { hi[0] = '\0'; }
+// next student in roll order, or nullptr at the end of the range
+Student* next() {
+    while (leaf && pos == leaf->n) { leaf = leaf->next; pos = 0; }
+    if (!leaf) return nullptr;
+    const char* k = leaf->keys[pos];
+    if (prefixLen > 0) {
+        if (strncmp(k, hi, prefixLen) != 0) { leaf = nullptr; return nullptr; }
+    } else if (bounded && strcmp(k, hi) > 0) {
+        leaf = nullptr;
+        return nullptr;
+    }
+    return leaf->vals[pos++];
+}
+};
+
+class RollIndex {
+private:
+BptNode* root;
+BptNode* first; // leftmost leaf
+int entries;
+
+RollIndex(const RollIndex&) = delete;
+RollIndex& operator=(const RollIndex&) = delete;
+
+static BptNode* newNode(bool leaf) {
+    BptNode* nd = memNewArray<BptNode>(MEM_INDEX, 1);
+    nd->n = 0;
+    nd->prefixLen = 0;
+    nd->leaf = leaf;
+    nd->prev = nd->next = nullptr;
+    return nd;
+}
+
+static char* copyKey(const char* k) {
+    char* c = memNewArray<char>(MEM_INDEX, strlen(k)+1);
+    strcpy(c, k);
+    return c;
+}
+static void freeKey(const char* k) { memDeleteArray(MEM_INDEX, (char*)k, strlen(k)+1); }
+
+static void freeTree(BptNode* nd) {
+    if (!nd->leaf) {
+        for (int i=0;i<=nd->n;i++) freeTree(nd->kids[i]);
+        for (int i=0;i<nd->n;i++) freeKey(nd->keys[i]);
+    }
+    memDeleteArray(MEM_INDEX, nd, 1);
+}
+
+// 8 key bytes starting at p, zero padded, big-endian
+static unsigned long long packHead(const char* k, int p) {
+    unsigned long long h = 0;
+    int i = 0;
+    for (; i<8 && k[p+i]; i++) h = (h << 8) | (unsigned char)k[p+i];
+    return i ? h << (8*(8-i)) : 0;
+}
+
+// recompute prefix and heads after the keys of nd changed
+static void refresh(BptNode* nd) {
+    int p = 0;
+    if (nd->n > 1) {
+        const char* a = nd->keys[0];
+        const char* b = nd->keys[nd->n-1];
+        while (a[p] && a[p] == b[p]) p++;
+    }
+    nd->prefixLen = p;
+    for (int i=0;i<nd->n;i++) nd->heads[i] = packHead(nd->keys[i], p);
+}
+
+// number of entries of nd ordered before (key, tie); equal entries count if orEqual
+static int rank(const BptNode* nd, const char* key, unsigned long long tie, bool orEqual) {
+    if (nd->n == 0) return 0;
+    int p = nd->prefixLen;
+    int pc = p ? strncmp(key, nd->keys[0], p) : 0;
+    if (pc < 0) return 0;         // below the node's shared prefix
+    if (pc > 0) return nd->n;     // above it
+    unsigned long long h = packHead(key, p);
+    int i = 0;
+    for (; i<nd->n; i++) {
+        int c;
+        if (h != nd->heads[i]) c = h < nd->heads[i] ? -1 : 1;
+        else if ((h & 0xff) == 0) c = 0;   // both strings end inside the head
+        else c = strcmp(key + p + 8, nd->keys[i] + p + 8);
+        if (c == 0) c = (tie < nd->ties[i]) ? -1 : (tie > nd->ties[i]) ? 1 : 0;
+        if (c < 0 || (c == 0 && !orEqual)) break;
+    }
+    return i;
+}
+
+// insert into the subtree at nd; on split returns the new right sibling and
+// sets (upKey, upTie) to the separator to add in the parent
+BptNode* insertRec(BptNode* nd, const char* key, unsigned long long tie, Student* s,
+                   const char*& upKey, unsigned long long& upTie) {
+    const char* ks[BPT_FANOUT+1];
+    unsigned long long ts[BPT_FANOUT+1];
+    if (nd->leaf) {
+        Student* vs[BPT_FANOUT+1];
+        int pos = rank(nd, key, tie, true);
+        int m = 0;
+        for (int i=0;i<=nd->n;i++) {
+            if (i == pos) { ks[m] = key; ts[m] = tie; vs[m] = s; m++; }
+            if (i < nd->n) { ks[m] = nd->keys[i]; ts[m] = nd->ties[i]; vs[m] = nd->vals[i]; m++; }
+        }
+        if (m <= BPT_FANOUT) {
+            for (int i=0;i<m;i++) { nd->keys[i] = ks[i]; nd->ties[i] = ts[i]; nd->vals[i] = vs[i]; }
+            nd->n = m;
+            refresh(nd);
+            return nullptr;
+        }
+        BptNode* right = newNode(true);
+        int half = m/2;
+        nd->n = 0;
+        for (int i=0;i<m;i++) {
+            BptNode* dst = i < half ? nd : right;
+            dst->keys[dst->n] = ks[i]; dst->ties[dst->n] = ts[i]; dst->vals[dst->n] = vs[i]; dst->n++;
+        }
+        right->next = nd->next;
+        if (right->next) right->next->prev = right;
+        right->prev = nd;
+        nd->next = right;
+        refresh(nd);
+        refresh(right);
+        upKey = copyKey(right->keys[0]);
+        upTie = right->ties[0];
+        return right;
+    }
+    int c = rank(nd, key, tie, true);
+    const char* sepKey;
+    unsigned long long sepTie;
+    BptNode* split = insertRec(nd->kids[c], key, tie, s, sepKey, sepTie);
+    if (!split) return nullptr;
+    BptNode* kd[BPT_FANOUT+2];
+    int m = 0;
+    for (int i=0;i<=nd->n;i++) {
+        if (i == c) { ks[m] = sepKey; ts[m] = sepTie; m++; }
+        if (i < nd->n) { ks[m] = nd->keys[i]; ts[m] = nd->ties[i]; m++; }
+    }
+    int kn = 0;
+    for (int i=0;i<=nd->n;i++) {
+        kd[kn++] = nd->kids[i];
+        if (i == c) kd[kn++] = split;
+    }
+    if (m <= BPT_FANOUT) {
+        for (int i=0;i<m;i++) { nd->keys[i] = ks[i]; nd->ties[i] = ts[i]; }
+        for (int i=0;i<kn;i++) nd->kids[i] = kd[i];
+        nd->n = m;
+        refresh(nd);
+        return nullptr;
+    }
+    // m == FANOUT+1 separators: the middle one moves up
+    int mid = m/2;
+    BptNode* right = newNode(false);
+    nd->n = 0;
+    for (int i=0;i<mid;i++) { nd->keys[i] = ks[i]; nd->ties[i] = ts[i]; nd->kids[i] = kd[i]; nd->n++; }
+    nd->kids[mid] = kd[mid];
+    for (int i=mid+1;i<m;i++) {
+        right->keys[right->n] = ks[i]; right->ties[right->n] = ts[i]; right->kids[right->n] = kd[i];
+        right->n++;
+    }
+    right->kids[right->n] = kd[m];
+    refresh(nd);
+    refresh(right);
+    upKey = ks[mid];
+    upTie = ts[mid];
+    return right;
+}
+
+// remove (key, tie) from the subtree at nd; returns true if nd is now empty
+bool removeRec(BptNode* nd, const char* key, unsigned long long tie, bool& found) {
+    if (nd->leaf) {
+        int pos = rank(nd, key, tie, false);
+        if (pos == nd->n || nd->ties[pos] != tie || strcmp(nd->keys[pos], key) != 0) return false;
+        found = true;
+        for (int i=pos+1;i<nd->n;i++) {
+            nd->keys[i-1] = nd->keys[i]; nd->ties[i-1] = nd->ties[i]; nd->vals[i-1] = nd->vals[i];
+        }
+        nd->n--;
+        refresh(nd);
+        return nd->n == 0;
+    }
+    int c = rank(nd, key, tie, true);
+    if (!removeRec(nd->kids[c], key, tie, found)) return false;
+    BptNode* kid = nd->kids[c];
+    if (kid->leaf) {
+        if (kid->prev) kid->prev->next = kid->next; else first = kid->next;
+        if (kid->next) kid->next->prev = kid->prev;
+    }
+    memDeleteArray(MEM_INDEX, kid, 1);
+    if (nd->n == 0) return true; // that was the only child
+    int sep = c > 0 ? c-1 : 0;
+    freeKey(nd->keys[sep]);
+    for (int i=sep+1;i<nd->n;i++) { nd->keys[i-1] = nd->keys[i]; nd->ties[i-1] = nd->ties[i]; }
+    for (int i=c+1;i<=nd->n;i++) nd->kids[i-1] = nd->kids[i];
+    nd->n--;
+    refresh(nd);
+    return false;
+}
+
+// leaf and position of the first entry >= (key, tie)
+const BptNode* lowerBound(const char* key, unsigned long long tie, int& pos) const {
+    const BptNode* nd = root;
+    while (!nd->leaf) nd = nd->kids[rank(nd, key, tie, true)];
+    pos = rank(nd, key, tie, false);
+    while (nd && pos == nd->n) { nd = nd->next; pos = 0; }
+    return nd;
+}
+
+public:
+RollIndex(): entries(0) { root = first = newNode(true); }
+~RollIndex() { freeTree(root); }
+
+int size() const { return entries; }
+
+// the index keeps a pointer to s's roll buffer: remove before the roll changes
+void insert(Student* s) {
+    const char* upKey;
+    unsigned long long upTie;
+    BptNode* split = insertRec(root, s->getRoll(), (unsigned long long)(size_t)s, s, upKey, upTie);
+    if (split) {
+        BptNode* r = newNode(false);
+        r->kids[0] = root;
+        r->kids[1] = split;
+        r->keys[0] = upKey;
+        r->ties[0] = upTie;
+        r->n = 1;
+        refresh(r);
+        root = r;
+    }
+    entries++;
+}
+
+bool remove(Student* s) {
+    bool found = false;
+    if (removeRec(root, s->getRoll(), (unsigned long long)(size_t)s, found) && !root->leaf) {
+        memDeleteArray(MEM_INDEX, root, 1); // every child is gone
+        root = first = newNode(true);
+    }
+    while (!root->leaf && root->n == 0) {
+        BptNode* only = root->kids[0];
+        memDeleteArray(MEM_INDEX, root, 1);
+        root = only;
+    }
+    if (found) entries--;
+    return found;
+}
+
+// first student with this roll, or nullptr
+Student* find(const char* roll) const {
+    int pos;
+    const BptNode* nd = lowerBound(roll, 0, pos);
+    if (!nd || strcmp(nd->keys[pos], roll) != 0) return nullptr;
+    return nd->vals[pos];
+}
+
+// students with lo <= roll <= hi (either bound may be null for open)
+RollRange range(const char* lo, const char* hi) const {
+    RollRange r;
+    if (lo) r.leaf = lowerBound(lo, 0, r.pos);
+    else { r.leaf = first; r.pos = 0; }
+    if (hi) {
+        if (strlen(hi) >= (size_t)ROLL_MAX) throw BufferOverflowException();
+        strcpy(r.hi, hi);
+        r.bounded = true;
+    }
+    return r;
+}
+
+// students whose roll starts with prefix (e.g. "21EC")
+RollRange withPrefix(const char* prefix) const {
+    RollRange r = range(prefix, nullptr);
+    if (strlen(prefix) >= (size_t)ROLL_MAX) throw BufferOverflowException();
+    strcpy(r.hi, prefix);
+    r.prefixLen = (int)strlen(prefix);
+    return r;
+}
+
+// all students in roll order (leaf walk); out must hold size() entries
+int collect(Student** out) const {
+    int k = 0;
+    for (const BptNode* nd = first; nd; nd = nd->next)
+        for (int i=0;i<nd->n;i++) out[k++] = nd->vals[i];
+    return k;
+}
+
+};
+
+/* -------------------------
+Marks columns and aggregate kernels
+Course mirrors every student's marks into dense per-component arrays (one
+row per student, rows filled from the end on removal), so roster-wide
+totals and statistics stream over contiguous doubles instead of chasing
+list nodes. The kernels have AVX2 and SSE2 versions plus a scalar
+fallback; simdLevel() picks one from the running CPU once.
+
+Totals add the components in the same order as Marks::total(), so they are
+bit-identical to totalMarks(). Sums and variances may differ from a scalar
+loop in the last bits because the vector versions add in lanes.
+------------------------- */
+
+enum SimdLevel { SIMD_SCALAR=0, SIMD_SSE2=1, SIMD_AVX2=2 };
+
+const char* simdLevelName(SimdLevel l) {
+return l == SIMD_AVX2 ? "avx2" : l == SIMD_SSE2 ? "sse2" : "scalar";
+}
+
+SimdLevel detectSimdLevel() {
+#ifdef MARKS_SIMD_X86
+__builtin_cpu_init();
+if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+return SIMD_SCALAR;
+}
+
+inline SimdLevel simdLevel() {
+static const SimdLevel lvl = detectSimdLevel();
+return lvl;
+}
+
+/* statistics of one column (population variance) */
+struct ColumnStats {
+double sum;
+double mean;
+double min;
+double max;
+double variance;
+};
+
+/* per-component and total statistics of a roster */
+struct MarksAggregate {
+int count;
+ColumnStats component[MC_COUNT]; // indexed by MarkComponent
+ColumnStats total;
+};
+
+void totalsScalar(const double* const* col, double* out, int n) {
+for (int i=0;i<n;i++) out[i] = col[MC_ASSIGN][i] + col[MC_MID][i] + col[MC_LAB][i] + col[MC_FINAL][i];
+}
+
+// sum/min/max in one pass, squared deviations in a second (no cancellation)
+void statsScalar(const double* x, int n, ColumnStats& st) {
+double s = 0, mn = x[0], mx = x[0];
+for (int i=0;i<n;i++) {
+    s += x[i];
+    if (x[i] < mn) mn = x[i];
+    if (x[i] > mx) mx = x[i];
+}
+double mean = s / n, ss = 0;
+for (int i=0;i<n;i++) ss += (x[i]-mean)*(x[i]-mean);
+st.sum = s; st.mean = mean; st.min = mn; st.max = mx; st.variance = ss / n;
+}
+
+#ifdef MARKS_SIMD_X86
+__attribute__((target("sse2")))
+void totalsSse2(const double* const* col, double* out, int n) {
+const double *a = col[MC_ASSIGN], *b = col[MC_MID], *c = col[MC_LAB], *d = col[MC_FINAL];
+int i = 0;
+for (; i+2<=n; i+=2) {
+    __m128d t = _mm_add_pd(_mm_loadu_pd(a+i), _mm_loadu_pd(b+i));
+    t = _mm_add_pd(_mm_add_pd(t, _mm_loadu_pd(c+i)), _mm_loadu_pd(d+i));
+    _mm_storeu_pd(out+i, t);
+}
+for (; i<n; i++) out[i] = a[i] + b[i] + c[i] + d[i];
+}
+
+__attribute__((target("sse2")))
+void statsSse2(const double* x, int n, ColumnStats& st) {
+__m128d s = _mm_setzero_pd(), mn = _mm_set1_pd(x[0]), mx = mn;
+int i = 0;
+for (; i+2<=n; i+=2) {
+    __m128d v = _mm_loadu_pd(x+i);
+    s = _mm_add_pd(s, v);
+    mn = _mm_min_pd(mn, v);
+    mx = _mm_max_pd(mx, v);
+}
+double ls[2], lmn[2], lmx[2];
+_mm_storeu_pd(ls, s); _mm_storeu_pd(lmn, mn); _mm_storeu_pd(lmx, mx);
+double sum = ls[0] + ls[1];
+double lo = lmn[0] < lmn[1] ? lmn[0] : lmn[1];
+double hi = lmx[0] > lmx[1] ? lmx[0] : lmx[1];
+for (; i<n; i++) {
+    sum += x[i];
+    if (x[i] < lo) lo = x[i];
+    if (x[i] > hi) hi = x[i];
+}
+double mean = sum / n;
+__m128d m = _mm_set1_pd(mean), q = _mm_setzero_pd();
+for (i=0; i+2<=n; i+=2) {
+    __m128d dv = _mm_sub_pd(_mm_loadu_pd(x+i), m);
+    q = _mm_add_pd(q, _mm_mul_pd(dv, dv));
+}
+double lq[2];
+_mm_storeu_pd(lq, q);
+double ss = lq[0] + lq[1];
+for (; i<n; i++) ss += (x[i]-mean)*(x[i]-mean);
+st.sum = sum; st.mean = mean; st.min = lo; st.max = hi; st.variance = ss / n;
+}
+
+__attribute__((target("avx2")))
+void totalsAvx2(const double* const* col, double* out, int n) {
+const double *a = col[MC_ASSIGN], *b = col[MC_MID], *c = col[MC_LAB], *d = col[MC_FINAL];
+int i = 0;
+for (; i+4<=n; i+=4) {
+    __m256d t = _mm256_add_pd(_mm256_loadu_pd(a+i), _mm256_loadu_pd(b+i));
+    t = _mm256_add_pd(_mm256_add_pd(t, _mm256_loadu_pd(c+i)), _mm256_loadu_pd(d+i));
+    _mm256_storeu_pd(out+i, t);
+}
+for (; i<n; i++) out[i] = a[i] + b[i] + c[i] + d[i];
+}
+
+__attribute__((target("avx2")))
+void statsAvx2(const double* x, int n, ColumnStats& st) {
+// two accumulators per quantity to hide add latency
+__m256d s0 = _mm256_setzero_pd(), s1 = s0;
+__m256d mn = _mm256_set1_pd(x[0]), mx = mn;
+int i = 0;
+for (; i+8<=n; i+=8) {
+    __m256d v0 = _mm256_loadu_pd(x+i), v1 = _mm256_loadu_pd(x+i+4);
+    s0 = _mm256_add_pd(s0, v0);
+    s1 = _mm256_add_pd(s1, v1);
+    mn = _mm256_min_pd(mn, _mm256_min_pd(v0, v1));
+    mx = _mm256_max_pd(mx, _mm256_max_pd(v0, v1));
+}
+double ls[4], lmn[4], lmx[4];
+_mm256_storeu_pd(ls, _mm256_add_pd(s0, s1));
+_mm256_storeu_pd(lmn, mn);
+_mm256_storeu_pd(lmx, mx);
+double sum = (ls[0] + ls[1]) + (ls[2] + ls[3]);
+double lo = lmn[0], hi = lmx[0];
+for (int k=1;k<4;k++) {
+    if (lmn[k] < lo) lo = lmn[k];
+    if (lmx[k] > hi) hi = lmx[k];
+}
+for (; i<n; i++) {
+    sum += x[i];
+    if (x[i] < lo) lo = x[i];
+    if (x[i] > hi) hi = x[i];
+}
+double mean = sum / n;
+__m256d m = _mm256_set1_pd(mean), q0 = _mm256_setzero_pd(), q1 = q0;
+for (i=0; i+8<=n; i+=8) {
+    __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(x+i), m);
+    __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(x+i+4), m);
+    q0 = _mm256_add_pd(q0, _mm256_mul_pd(d0, d0));
+    q1 = _mm256_add_pd(q1, _mm256_mul_pd(d1, d1));
+}
+double lq[4];
+_mm256_storeu_pd(lq, _mm256_add_pd(q0, q1));
+double ss = (lq[0] + lq[1]) + (lq[2] + lq[3]);
+for (; i<n; i++) ss += (x[i]-mean)*(x[i]-mean);
+st.sum = sum; st.mean = mean; st.min = lo; st.max = hi; st.variance = ss / n;
+}
+#endif
+
+/* out[i] = total of row i; col is indexed by MarkComponent */
+void columnTotals(const double* const* col, double* out, int n, SimdLevel lvl = simdLevel()) {
+#ifdef MARKS_SIMD_X86
+if (lvl == SIMD_AVX2) { totalsAvx2(col, out, n); return; }
+if (lvl == SIMD_SSE2) { totalsSse2(col, out, n); return; }
+#endif
+totalsScalar(col, out, n);
+}
+
+/* statistics of x[0..n); all zero when n == 0 */
+ColumnStats columnStats(const double* x, int n, SimdLevel lvl = simdLevel()) {
+ColumnStats st = {0, 0, 0, 0, 0};
+if (n <= 0) return st;
+#ifdef MARKS_SIMD_X86
+if (lvl == SIMD_AVX2) { statsAvx2(x, n, st); return st; }
+if (lvl == SIMD_SSE2) { statsSse2(x, n, st); return st; }
+#endif
+statsScalar(x, n, st);
+return st;
+}
+
+/* dense marks columns; row r belongs to the slot rowSlot[r] */
+class MarksColumns {
+private:
+double* col[MC_COUNT];
+int* rowSlot;
+int n;
+int cap;
+MarksColumns(const MarksColumns&) = delete;
+MarksColumns& operator=(const MarksColumns&) = delete;
+public:
+MarksColumns(): rowSlot(nullptr), n(0), cap(0) {
+    for (int c=0;c<MC_COUNT;c++) col[c] = nullptr;
+}
+~MarksColumns() {
+    for (int c=0;c<MC_COUNT;c++) memDeleteArray(MEM_COLUMNS, col[c], cap);
+    memDeleteArray(MEM_COLUMNS, rowSlot, cap);
+}
+// append a row; returns its index
+int append(int slot, const Marks& m) {
+    if (n == cap) {
+        int newcap = cap ? cap*2 : 64;
+        for (int c=0;c<MC_COUNT;c++) {
+            double* tmp = memNewArray<double>(MEM_COLUMNS, newcap);
+            if (n) memcpy(tmp, col[c], n*sizeof(double));
+            memDeleteArray(MEM_COLUMNS, col[c], cap);
+            col[c] = tmp;
+        }
+        int* rs = memNewArray<int>(MEM_COLUMNS, newcap);
+        if (n) memcpy(rs, rowSlot, n*sizeof(int));
+        memDeleteArray(MEM_COLUMNS, rowSlot, cap);
+        rowSlot = rs;
+        cap = newcap;
+    }
+    rowSlot[n] = slot;
+    set(n, m);
+    return n++;
+}
+// drop row r by moving the last row into it; returns the moved row's slot, or -1
+int remove(int r) {
+    n--;
+    if (r == n) return -1;
+    for (int c=0;c<MC_COUNT;c++) col[c][r] = col[c][n];
+    rowSlot[r] = rowSlot[n];
+    return rowSlot[r];
+}
+void set(int r, const Marks& m) {
+    for (int c=0;c<MC_COUNT;c++) col[c][r] = m.at((MarkComponent)c);
+}
+void set(int r, MarkComponent mc, double v) { col[mc][r] = v; }
+const double* const* columns() const { return col; }
+const double* column(MarkComponent mc) const { return col[mc]; }
+int slotOf(int r) const { return rowSlot[r]; }
+int size() const { return n; }
+};
+
+/* -------------------------
+Grading schemes
+A scheme is declared as data: a weight and an optional cap per component
+(the cap applies to the raw marks, the weight after), an optional best-of
+rule (keep the best bestOf weighted values among the components in
+bestOfMask) and an optional cap on the total.
+
+Common schemes are structs with static constexpr members; schemeTotal<S>()
+and schemeTotals<S>() are specialised for them at compile time, so unused
+rules cost nothing; weighted sums run through the same SIMD loops as
+columnTotals(), with caps and weights as folded constants.
+GradingScheme holds the same description at runtime (e.g. read from a
+course config) and is the fallback for schemes not known at compile time.
+------------------------- */
+
+constexpr double GRADE_NO_CAP = 1e300;
+
+/* sum of v[], keeping only the best bestOf of the components in mask */
+inline double gradeCombine(const double* v, unsigned mask, int bestOf) {
+double sum = 0;
+double pick[MC_COUNT];
+int np = 0;
+for (int c=0;c<MC_COUNT;c++) {
+    if (mask & (1u << c)) pick[np++] = v[c];
+    else sum += v[c];
+}
+// drop the smallest competitors until bestOf remain
+while (np > bestOf) {
+    int lo = 0;
+    for (int i=1;i<np;i++) if (pick[i] < pick[lo]) lo = i;
+    pick[lo] = pick[--np];
+}
+for (int i=0;i<np;i++) sum += pick[i];
+return sum;
+}
+
+/* runtime scheme */
+struct GradingScheme {
+double weight[MC_COUNT];
+double cap[MC_COUNT];   // on raw marks, GRADE_NO_CAP for none
+unsigned bestOfMask;    // bit (1 << MarkComponent) per competing component
+int bestOf;             // 0: rule off
+double totalCap;
+
+double total(const Marks& m) const {
+    double v[MC_COUNT];
+    for (int c=0;c<MC_COUNT;c++) {
+        double x = m.at((MarkComponent)c);
+        if (x > cap[c]) x = cap[c];
+        v[c] = x * weight[c];
+    }
+    double t = bestOf > 0 ? gradeCombine(v, bestOfMask, bestOf)
+                          : v[MC_ASSIGN] + v[MC_MID] + v[MC_LAB] + v[MC_FINAL];
+    return t > totalCap ? totalCap : t;
+}
+};
+
+/* compile-time schemes: the unweighted sum (same as Marks::total) ... */
+struct SchemeRawSum {
+static constexpr double weight[MC_COUNT] = {1, 1, 1, 1};
+static constexpr double cap[MC_COUNT] = {GRADE_NO_CAP, GRADE_NO_CAP, GRADE_NO_CAP, GRADE_NO_CAP};
+static constexpr unsigned bestOfMask = 0;
+static constexpr int bestOf = 0;
+static constexpr double totalCap = GRADE_NO_CAP;
+};
+
+/* ... exam-weighted, out of 100 (7.5 + 22.5 + 7.5 + 62.5 at full marks) ... */
+struct SchemeExamWeighted {
+static constexpr double weight[MC_COUNT] = {0.375, 0.75, 0.5, 1.25};
+static constexpr double cap[MC_COUNT] = {20, 30, 15, 50};
+static constexpr unsigned bestOfMask = 0;
+static constexpr int bestOf = 0;
+static constexpr double totalCap = 100;
+};
+
+/* ... and the better of midterm and final (scaled to the final's range) */
+struct SchemeBestExam {
+static constexpr double weight[MC_COUNT] = {1.0, 50.0/30.0, 1.0, 1.0};
+static constexpr double cap[MC_COUNT] = {GRADE_NO_CAP, 30, GRADE_NO_CAP, 50};
+static constexpr unsigned bestOfMask = (1u << MC_MID) | (1u << MC_FINAL);
+static constexpr int bestOf = 1;
+static constexpr double totalCap = GRADE_NO_CAP;
+};
+
+template<class S, int C> inline double schemeComponent(const Marks& m) {
+double x = m.at((MarkComponent)C);
+if constexpr (S::cap[C] < GRADE_NO_CAP) { if (x > S::cap[C]) x = S::cap[C]; }
+if constexpr (S::weight[C] != 1.0) x *= S::weight[C];
+return x;
+}
+
+template<class S> inline double schemeTotal(const Marks& m) {
+double t;
+if constexpr (S::bestOf > 0) {
+    double v[MC_COUNT] = { schemeComponent<S, MC_ASSIGN>(m), schemeComponent<S, MC_MID>(m),
+                           schemeComponent<S, MC_LAB>(m), schemeComponent<S, MC_FINAL>(m) };
+    t = gradeCombine(v, S::bestOfMask, S::bestOf);
+} else {
+    t = schemeComponent<S, MC_ASSIGN>(m) + schemeComponent<S, MC_MID>(m)
+      + schemeComponent<S, MC_LAB>(m) + schemeComponent<S, MC_FINAL>(m);
+}
+if constexpr (S::totalCap < GRADE_NO_CAP) { if (t > S::totalCap) t = S::totalCap; }
+return t;
+}
+
+/* a compile-time scheme as runtime data */
+template<class S> GradingScheme schemeOf() {
+GradingScheme g;
+for (int c=0;c<MC_COUNT;c++) { g.weight[c] = S::weight[c]; g.cap[c] = S::cap[c]; }
+g.bestOfMask = S::bestOfMask;
+g.bestOf = S::bestOf;
+g.totalCap = S::totalCap;
+return g;
+}
+
+template<class S, int C> inline double schemeColumn(const double* x, int i) {
+double v = x[i];
+if constexpr (S::cap[C] < GRADE_NO_CAP) v = v > S::cap[C] ? S::cap[C] : v;
+if constexpr (S::weight[C] != 1.0) v *= S::weight[C];
+return v;
+}
+
+/* scheme total of row i of columns a..d */
+template<class S> inline double schemeRow(const double* a, const double* b, const double* c, const double* d, int i) {
+double t;
+if constexpr (S::bestOf > 0) {
+    double v[MC_COUNT] = { schemeColumn<S, MC_ASSIGN>(a, i), schemeColumn<S, MC_MID>(b, i),
+                           schemeColumn<S, MC_LAB>(c, i), schemeColumn<S, MC_FINAL>(d, i) };
+    t = gradeCombine(v, S::bestOfMask, S::bestOf);
+} else {
+    t = schemeColumn<S, MC_ASSIGN>(a, i) + schemeColumn<S, MC_MID>(b, i)
+      + schemeColumn<S, MC_LAB>(c, i) + schemeColumn<S, MC_FINAL>(d, i);
+}
+if constexpr (S::totalCap < GRADE_NO_CAP) t = t > S::totalCap ? S::totalCap : t;
+return t;
+}
+
+#ifdef MARKS_SIMD_X86
+// Weighted-sum schemes in the same shape as totalsSse2/totalsAvx2: the caps
+// and weights are constants folded into the loop, and rules a scheme does
+// not use emit no instructions. min(cap, v) keeps NaN like the scalar path.
+template<class S, int C> __attribute__((target("sse2"))) inline __m128d schemeLane2(const double* x) {
+__m128d v = _mm_loadu_pd(x);
+if constexpr (S::cap[C] < GRADE_NO_CAP) v = _mm_min_pd(_mm_set1_pd(S::cap[C]), v);
+if constexpr (S::weight[C] != 1.0) v = _mm_mul_pd(v, _mm_set1_pd(S::weight[C]));
+return v;
+}
+
+template<class S> __attribute__((target("sse2")))
+void schemeTotalsSse2(const double* a, const double* b, const double* c, const double* d, double* out, int n) {
+int i = 0;
+for (; i+2<=n; i+=2) {
+    __m128d t = _mm_add_pd(schemeLane2<S, MC_ASSIGN>(a+i), schemeLane2<S, MC_MID>(b+i));
+    t = _mm_add_pd(_mm_add_pd(t, schemeLane2<S, MC_LAB>(c+i)), schemeLane2<S, MC_FINAL>(d+i));
+    if constexpr (S::totalCap < GRADE_NO_CAP) t = _mm_min_pd(_mm_set1_pd(S::totalCap), t);
+    _mm_storeu_pd(out+i, t);
+}
+for (; i<n; i++) out[i] = schemeRow<S>(a, b, c, d, i);
+}
+
+template<class S, int C> __attribute__((target("avx2"))) inline __m256d schemeLane4(const double* x) {
+__m256d v = _mm256_loadu_pd(x);
+if constexpr (S::cap[C] < GRADE_NO_CAP) v = _mm256_min_pd(_mm256_set1_pd(S::cap[C]), v);
+if constexpr (S::weight[C] != 1.0) v = _mm256_mul_pd(v, _mm256_set1_pd(S::weight[C]));
+return v;
+}
+
+template<class S> __attribute__((target("avx2")))
+void schemeTotalsAvx2(const double* a, const double* b, const double* c, const double* d, double* out, int n) {
+int i = 0;
+for (; i+4<=n; i+=4) {
+    __m256d t = _mm256_add_pd(schemeLane4<S, MC_ASSIGN>(a+i), schemeLane4<S, MC_MID>(b+i));
+    t = _mm256_add_pd(_mm256_add_pd(t, schemeLane4<S, MC_LAB>(c+i)), schemeLane4<S, MC_FINAL>(d+i));
+    if constexpr (S::totalCap < GRADE_NO_CAP) t = _mm256_min_pd(_mm256_set1_pd(S::totalCap), t);
+    _mm256_storeu_pd(out+i, t);
+}
+for (; i<n; i++) out[i] = schemeRow<S>(a, b, c, d, i);
+}
+#endif
+
+/* scheme totals over marks columns; weighted sums take the same SIMD path
+   as columnTotals(), best-of schemes a scalar loop */
+template<class S> void schemeTotals(const double* const* col, double* out, int n, SimdLevel lvl = simdLevel()) {
+const double *a = col[MC_ASSIGN], *b = col[MC_MID], *c = col[MC_LAB], *d = col[MC_FINAL];
+if constexpr (S::bestOf == 0) {
+#ifdef MARKS_SIMD_X86
+    if (lvl == SIMD_AVX2) { schemeTotalsAvx2<S>(a, b, c, d, out, n); return; }
+    if (lvl == SIMD_SSE2) { schemeTotalsSse2<S>(a, b, c, d, out, n); return; }
+#endif
+}
+for (int i=0;i<n;i++) out[i] = schemeRow<S>(a, b, c, d, i);
+}
+
+/* runtime fallback over columns */
+void schemeTotals(const GradingScheme& g, const double* const* col, double* out, int n) {
+Marks m;
+for (int i=0;i<n;i++) {
+    for (int c=0;c<MC_COUNT;c++) m.at((MarkComponent)c) = col[c][i];
+    out[i] = g.total(m);
+}
+}
+
+/* -------------------------
+Marks histograms
+Counts of students per bin for every MarkComponent and the total, kept per
+(branch, level) group. Course updates them as students are added, removed
+or edited, so a chart reads a distribution in O(bins) instead of scanning
+the roster. Bins cover [0, HIST_RANGE) in steps of the bin width (1 or 5);
+values outside land in the underflow/overflow counters (NaN counts as
+overflow). Students whose branch or level has no group are not counted.
+------------------------- */
+
+const int HIST_TOTAL = MC_COUNT;     // series index of the total
+const int HIST_SERIES = MC_COUNT + 1;
+const int HIST_RANGE = 300;          // marks covered by the bins (divisible by 1 and 5)
+const int HIST_BINS_MAX = HIST_RANGE; // at bin width 1
+const int HIST_BRANCHES = 2;
+const int HIST_LEVELS = 3;
+const int HIST_ANY = -1;             // branch/level filter: all
+
+/* one distribution, as read from MarksHistograms */
+struct MarksHistogram {
+int binWidth;
+int nbins;             // bin i counts [i*binWidth, (i+1)*binWidth)
+int counts[HIST_BINS_MAX];
+int underflow;         // below 0
+int overflow;          // HIST_RANGE and above, or NaN
+int students;
+};
+
+class MarksHistograms {
+private:
+int width;
+int nbins;
+// [group][series][nbins + 2]: slot 0 underflow, 1..nbins bins, nbins+1 overflow
+int* cells;
+
+int* row(int group, int series) const { return cells + ((size_t)group*HIST_SERIES + series)*(nbins+2); }
+// -1 when the branch or level has no group
+static int groupOf(const Student* s) {
+    int b = s->getBranch(), l = s->getLevel();
+    if (b < 0 || b >= HIST_BRANCHES || l < 0 || l >= HIST_LEVELS) return -1;
+    return b*HIST_LEVELS + l;
+}
+int cellOf(double v) const {
+    if (v < 0) return 0;
+    if (!(v < HIST_RANGE)) return nbins + 1; // also NaN
+    return 1 + (int)(v / width);
+}
+void update(const Student* s, int delta) {
+    int g = groupOf(s);
+    if (g < 0) return;
+    const Marks& m = s->getMarks();
+    for (int c=0;c<MC_COUNT;c++) row(g, c)[cellOf(m.at((MarkComponent)c))] += delta;
+    row(g, HIST_TOTAL)[cellOf(m.total())] += delta;
+}
+MarksHistograms(const MarksHistograms&) = delete;
+MarksHistograms& operator=(const MarksHistograms&) = delete;
+
+public:
+// binWidth 1 or 5 (any divisor of HIST_RANGE works)
+MarksHistograms(int binWidth) {
+    if (binWidth < 1 || HIST_RANGE % binWidth) throw InvalidBinWidthException();
+    width = binWidth;
+    nbins = HIST_RANGE / binWidth;
+    size_t n = (size_t)HIST_BRANCHES*HIST_LEVELS*HIST_SERIES*(nbins+2);
+    cells = memNewArray<int>(MEM_COLUMNS, n);
+    memset(cells, 0, n*sizeof(int));
+}
+~MarksHistograms() {
+    memDeleteArray(MEM_COLUMNS, cells, (size_t)HIST_BRANCHES*HIST_LEVELS*HIST_SERIES*(nbins+2));
+}
+
+void add(const Student* s) { update(s, 1); }
+void remove(const Student* s) { update(s, -1); }
+
+int binWidth() const { return width; }
+
+// distribution of series (a MarkComponent or HIST_TOTAL) for one branch and
+// level, or HIST_ANY for either; O(bins) per group read
+MarksHistogram read(int series, int branch = HIST_ANY, int level = HIST_ANY) const {
+    MarksHistogram h;
+    h.binWidth = width;
+    h.nbins = nbins;
+    h.underflow = h.overflow = h.students = 0;
+    for (int i=0;i<nbins;i++) h.counts[i] = 0;
+    for (int b=0;b<HIST_BRANCHES;b++) {
+        if (branch != HIST_ANY && branch != b) continue;
+        for (int l=0;l<HIST_LEVELS;l++) {
+            if (level != HIST_ANY && level != l) continue;
+            const int* r = row(b*HIST_LEVELS + l, series);
+            h.underflow += r[0];
+            h.overflow += r[nbins+1];
+            for (int i=0;i<nbins;i++) h.counts[i] += r[i+1];
+        }
+    }
+    h.students = h.underflow + h.overflow;
+    for (int i=0;i<nbins;i++) h.students += h.counts[i];
+    return h;
+}
+};
+
+/* -------------------------
+Storage: doubly linked list of students + slot map of handles
+operator overloading:
+Course += Student*  (adds a student - Course takes ownership, returns a StudentHandle)
+Course(roll) -> returns pointer to Student for modification (throws if not found)
+
+A StudentHandle names a slot in the slot map plus the generation the slot had
+when the student was added. Removing a student bumps the slot's generation, so
+stale handles are detected instead of aliasing whoever reuses the slot.
+------------------------- */
+
+/* runtime statistics reported by Course::stats() */
+struct CourseStats {
+int students;
+long long viewRebuilds;     // cached sorted views fully re-sorted
+long long viewPatches;      // ... patched by binary-search reinsertion
+long long gradeFullPasses;  // letter grades assigned to the whole roster
+long long gradeIncrementals; // ... to the changed students only
+bool rollFilter;            // counting Bloom filter enabled?
+int filterCounters;
+int filterHashes;
+long long filterQueries;
+long long filterNegatives;  // lookups answered without a scan
+long long filterFalsePositives;
+double filterObservedFpr;
+double filterEstimatedFpr;
+};
+
+/* one row of a batched mark update: set component of roll to value */
+struct MarkUpdate {
+const char* roll;
+MarkComponent component;
+double value;
+};
+
+struct BatchResult {
+int applied;
+int notFound; // rows whose roll is not in the course (skipped)
+};
+
+/* relative grading: how the bands of a grade curve are cut */
+enum CurveMode {
+CURVE_PERCENTILE, // band value = fraction of the class at or above it (0.1 = top 10%)
+CURVE_STDDEV      // band value = z: cut-off at mean + z * stddev of the totals
+};
+
+const int GRADE_BANDS_MAX = 12;
+const int GRADE_NONE = -1;
+
+/* one band of a curve, best first; the last band takes everyone left */
+struct GradeBand {
+char letter[4];
+double value;
+};
+
+/* restore the min-heap property below p in h[0..n) */
+void siftDownMin(double* h, int p, int n) {
+for (;;) {
+    int c = 2*p + 1;
+    if (c >= n) return;
+    if (c+1 < n && h[c+1] < h[c]) c++;
+    if (h[p] <= h[c]) return;
+    double t = h[p]; h[p] = h[c]; h[c] = t;
+    p = c;
+}
+}
+
+/* sort a[lo..hi] descending: heapsort that moves the minimum to the back */
+void heapSortDescending(double* a, int lo, int hi) {
+double* h = a + lo;
+int n = hi - lo + 1;
+for (int p = n/2 - 1; p >= 0; p--) siftDownMin(h, p, n);
+for (int end = n-1; end > 0; end--) {
+    double t = h[0]; h[0] = h[end]; h[end] = t;
+    siftDownMin(h, 0, end);
+}
+}
+
+/* k-th largest of a[lo..hi] (k absolute), partially ordering a so that
+   a[lo..k) >= a[k] >= a(k..hi]. Quickselect with a median-of-three pivot,
+   so sorted and reverse-sorted input stay linear; if the range fails to
+   shrink within 2 log2(n) rounds the rest is heapsorted (introselect). */
+double selectKthLargest(double* a, int lo, int hi, int k) {
+int budget = 2;
+for (int m = hi - lo + 1; m > 1; m >>= 1) budget += 2;
+while (lo < hi) {
+    if (budget-- == 0) { heapSortDescending(a, lo, hi); break; }
+    int mid = lo + (hi-lo)/2;
+    // order a[lo] >= a[mid] >= a[hi]; the median is the pivot and the
+    // outer two stop the scans below
+    if (a[mid] > a[lo]) { double t = a[mid]; a[mid] = a[lo]; a[lo] = t; }
+    if (a[hi] > a[lo]) { double t = a[hi]; a[hi] = a[lo]; a[lo] = t; }
+    if (a[hi] > a[mid]) { double t = a[mid]; a[mid] = a[hi]; a[hi] = t; }
+    double pv = a[mid];
+    int i = lo, j = hi;
+    while (i <= j) {
+        while (a[i] > pv) i++;
+        while (a[j] < pv) j--;
+        if (i <= j) { double t = a[i]; a[i] = a[j]; a[j] = t; i++; j--; }
+    }
+    if (k <= j) hi = j;
+    else if (k >= i) lo = i;
+    else return a[k];
+}
+return a[k];
+}
+
+class Course;
+
+/* time-travel view returned by Course::asOf(ts) */
+class CourseAsOf {
+private:
+Course& course;
+Timestamp ts;
+public:
+CourseAsOf(Course& c, Timestamp t): course(c), ts(t) {}
+// marks of roll as of ts. Throws RollNotFoundException if the student is
+// unknown or had no recorded marks at ts (e.g. added later, history collected)
+Marks operator()(const char* roll) const;
+};
+
+struct StudentHandle {
+int slot;
+unsigned gen;
+StudentHandle(int s=-1, unsigned g=0): slot(s), gen(g) {}
+bool valid() const { return slot >= 0; }
+};
+
+class Course : private StudentObserver {
+private:
+struct Node {
+Student* student;
+Node* prev;
+Node* next;
+int slot;
+Node(Student* s=nullptr): student(s), prev(nullptr), next(nullptr), slot(-1) {}
+static void* operator new(size_t sz) { memAlloc(MEM_NODES, sz); return ::operator new(sz); }
+static void operator delete(void* p, size_t sz) { memFree(MEM_NODES, sz); ::operator delete(p); }
+};
+struct Slot {
+Node* node;      // nullptr when the slot is free
+unsigned gen;    // bumped on every removal
+int nextFree;    // free list link
+MarksVersion* history; // older marks, newest first (history mode)
+Timestamp since;       // when the current marks became valid
+int row;               // row in cols
+int grade;             // band index under the grade curve, GRADE_NONE if not graded
+};
+Node* head;
+int count;
+Slot* slots;
+int slotCap;
+int freeSlot;    // head of the free list, -1 when empty
+RollBloomFilter* bloom; // optional, see enableRollFilter()
+RollIndex rollIndex;    // ordered roll index (B+tree)
+RosterPublisher* snap;  // optional, see enableSnapshots()
+MarksColumns cols;      // dense marks for computeTotals()/aggregate()
+MarksHistograms* hist;  // optional, see enableHistograms()
+
+// marks history (see enableHistory)
+bool historyOn;
+Timestamp retention;
+Timestamp (*clock)();
+mutable std::mutex historyLock; // chains vs. background collection
+std::thread gcThread;
+std::mutex gcWaitLock;
+std::condition_variable gcWake;
+bool gcStop;
+
+// push the marks s currently holds as a closed version ending now
+void archiveMarks(Student* s, Timestamp now) {
+    Slot& sl = slots[s->ownerSlot];
+    if (sl.since == now) return; // never visible: replaced within the same tick
+    MarksVersion* v = memNewArray<MarksVersion>(MEM_HISTORY, 1);
+    v->marks = s->marks;
+    v->validFrom = sl.since;
+    v->validTo = now;
+    std::lock_guard<std::mutex> g(historyLock);
+    v->older = sl.history;
+    sl.history = v;
+    sl.since = now;
+}
+unsigned long long version; // bumped on every mutation (once per batch)
+
+// Cached sorted views, one per SortKey, checked lazily against version.
+// Recent mutations are kept in a small ring log; a stale view whose missing
+// mutations are all still in the log is patched (remove touched records,
+// binary-search reinsert), otherwise it is rebuilt from scratch.
+enum MutationKind { MUT_ADD=0, MUT_REMOVE=1, MUT_CHANGE=2 };
+struct Mutation {
+unsigned long long version;
+Student* student; // compared by address only; may be dangling for MUT_REMOVE
+int kind;
+};
+static const int MUTATION_LOG = 64;
+struct SortedView {
+Student** arr;
+int n;
+int cap;
+bool built;
+unsigned long long builtAt;
+};
+Mutation mutLog[MUTATION_LOG];
+int mutHead;        // next write position
+int mutCount;
+unsigned long long mutFloor; // newest version with a dropped log entry
+SortedView views[SK_COUNT];
+long long viewRebuilds;
+long long viewPatches;
+
+// letter grades (see setGradeCurve), refreshed lazily against version
+GradeBand bands[GRADE_BANDS_MAX];
+int nbands;
+CurveMode curveMode;
+double gradeCut[GRADE_BANDS_MAX]; // cut-offs the current grades were assigned with
+bool graded;
+unsigned long long gradedAt;
+long long gradeFullPasses;
+long long gradeIncrementals;
+
+void logMutation(Student* s, int kind) {
+    if (mutCount == MUTATION_LOG) {
+        mutFloor = mutLog[mutHead].version;
+        mutCount--;
+    }
+    mutLog[mutHead].version = version;
+    mutLog[mutHead].student = s;
+    mutLog[mutHead].kind = kind;
+    mutHead = (mutHead+1) % MUTATION_LOG;
+    mutCount++;
+}
+
+void rebuildView(SortedView& v, SortKey k) {
+    if (v.cap < count) {
+        memDeleteArray(MEM_VIEWS, v.arr, v.cap);
+        v.cap = count < 16 ? 16 : count;
+        v.arr = memNewArray<Student*>(MEM_VIEWS, v.cap);
+    }
+    v.n = count;
+    if (k == SK_ROLL) {
+        rollIndex.collect(v.arr); // already ordered: walk the B+tree leaves
+    } else {
+        int idx = 0;
+        for (Node* cur = head; cur; cur = cur->next) v.arr[idx++] = cur->student;
+        quickSortByKey(v.arr, 0, v.n-1, k);
+    }
+    viewRebuilds++;
+}
+
+static int cmpPtr(const Student* a, const Student* b) { return (a < b) ? -1 : (a > b) ? 1 : 0; }
+
+// records touched after version since, with the last kind logged for each
+// address; the caller checks since >= mutFloor (no gap in the log)
+int touchedSince(unsigned long long since, Student** touched, int* kinds) const {
+    int m = 0;
+    for (int i=0;i<mutCount;i++) {
+        const Mutation& mu = mutLog[(mutHead - mutCount + i + MUTATION_LOG) % MUTATION_LOG];
+        if (mu.version <= since) continue;
+        int j = 0;
+        while (j < m && touched[j] != mu.student) j++;
+        if (j == m) { touched[m] = mu.student; m++; }
+        kinds[j] = mu.kind;
+    }
+    return m;
+}
+
+// bring v up to date using the mutation log; false if the log has a gap
+bool patchView(SortedView& v, SortKey k) {
+    if (v.builtAt < mutFloor) return false;
+    // touched records since builtAt, last kind per address, sorted by address
+    Student* touched[MUTATION_LOG];
+    int kinds[MUTATION_LOG];
+    int m = touchedSince(v.builtAt, touched, kinds);
+    for (int i=1;i<m;i++) {
+        Student* t = touched[i]; int kd = kinds[i]; int j = i-1;
+        while (j >= 0 && cmpPtr(touched[j], t) > 0) { touched[j+1]=touched[j]; kinds[j+1]=kinds[j]; j--; }
+        touched[j+1] = t; kinds[j+1] = kd;
+    }
+    // drop touched records (address comparisons only)
+    int w = 0;
+    for (int i=0;i<v.n;i++) {
+        int lo = 0, hi = m-1; bool hit = false;
+        while (lo <= hi) {
+            int mid = (lo+hi)/2;
+            int c = cmpPtr(touched[mid], v.arr[i]);
+            if (c == 0) { hit = true; break; }
+            if (c < 0) lo = mid+1; else hi = mid-1;
+        }
+        if (!hit) v.arr[w++] = v.arr[i];
+    }
+    v.n = w;
+    if (v.cap < count) {
+        int newcap = v.cap*2 < count ? count : v.cap*2;
+        Student** tmp = memNewArray<Student*>(MEM_VIEWS, newcap);
+        for (int i=0;i<v.n;i++) tmp[i] = v.arr[i];
+        memDeleteArray(MEM_VIEWS, v.arr, v.cap);
+        v.arr = tmp;
+        v.cap = newcap;
+    }
+    // reinsert live touched records at their binary-searched position
+    for (int t=0;t<m;t++) {
+        if (kinds[t] == MUT_REMOVE) continue;
+        int lo = 0, hi = v.n;
+        while (lo < hi) {
+            int mid = (lo+hi)/2;
+            if (compareKeyThenRoll(v.arr[mid], touched[t], k) < 0) lo = mid+1; else hi = mid;
+        }
+        memmove(v.arr+lo+1, v.arr+lo, (v.n-lo)*sizeof(Student*));
+        v.arr[lo] = touched[t];
+        v.n++;
+    }
+    viewPatches++;
+    return true;
+}
+
+// Cut-offs for the current totals. Percentile bands read order statistics
+// from the SK_TOTAL view when it can be patched from the mutation log, and
+// otherwise select them from the marks columns in linear time.
+void computeCutoffs(double* cut) {
+    int n = count;
+    if (curveMode == CURVE_STDDEV) {
+        MarksAggregate ag = aggregate();
+        double sd = sqrt(ag.total.variance);
+        for (int b=0;b<nbands;b++) cut[b] = ag.total.mean + bands[b].value * sd;
+    } else {
+        const SortedView& tv = views[SK_TOTAL];
+        bool patchable = tv.built && tv.builtAt >= mutFloor;
+        Student* const* asc = patchable ? sortedView(SK_TOTAL) : nullptr;
+        double* totals = nullptr;
+        if (!asc) {
+            totals = memNewArray<double>(MEM_COLUMNS, n);
+            columnTotals(cols.columns(), totals, n);
+        }
+        int from = 0;
+        for (int b=0;b<nbands;b++) {
+            int k = (int)ceil(bands[b].value * n) - 1; // 0-based rank from the top
+            if (k < 0) k = 0;
+            if (k > n-1) k = n-1;
+            if (asc) cut[b] = asc[n-1-k]->totalMarks();
+            else {
+                // bands are best first, so ranks normally only grow and each
+                // selection works on what the previous one left below it
+                cut[b] = selectKthLargest(totals, k >= from ? from : 0, n-1, k);
+                from = k;
+            }
+        }
+        memDeleteArray(MEM_COLUMNS, totals, n);
+    }
+    cut[nbands-1] = -GRADE_NO_CAP; // last band takes everyone left
+}
+
+int bandFor(double total, const double* cut) const {
+    int b = 0;
+    while (b < nbands-1 && total < cut[b]) b++;
+    return b;
+}
+
+// bring letter grades up to date: only the students changed since the last
+// grading when the cut-offs did not move, the whole roster otherwise
+void refreshGrades() {
+    if (nbands == 0 || (graded && gradedAt == version)) return;
+    if (count == 0) { graded = true; gradedAt = version; return; }
+    double cut[GRADE_BANDS_MAX];
+    computeCutoffs(cut);
+    bool sameCuts = graded && memcmp(cut, gradeCut, nbands*sizeof(double)) == 0;
+    if (sameCuts && gradedAt >= mutFloor) {
+        Student* touched[MUTATION_LOG];
+        int kinds[MUTATION_LOG];
+        int m = touchedSince(gradedAt, touched, kinds);
+        for (int i=0;i<m;i++) {
+            if (kinds[i] == MUT_REMOVE) continue;
+            slots[touched[i]->ownerSlot].grade = bandFor(touched[i]->totalMarks(), cut);
+        }
+        gradeIncrementals++;
+    } else {
+        for (Node* cur = head; cur; cur = cur->next)
+            slots[cur->slot].grade = bandFor(cur->student->totalMarks(), cut);
+        gradeFullPasses++;
+    }
+    memcpy(gradeCut, cut, nbands*sizeof(double));
+    graded = true;
+    gradedAt = version;
+}
+
+// disallow copying to respect data hiding ownership
+Course(const Course&) = delete;
+Course& operator=(const Course&) = delete;
+
+int acquireSlot() {
+    if (freeSlot < 0) {
+        int newcap = (slotCap==0)?16:slotCap*2;
+        Slot* tmp = memNewArray<Slot>(MEM_INDEX, newcap);
+        std::lock_guard<std::mutex> g(historyLock); // background collection walks slots
+        for (int i=0;i<slotCap;i++) tmp[i]=slots[i];
+        for (int i=slotCap;i<newcap;i++) {
+            tmp[i].node = nullptr;
+            tmp[i].gen = 0;
+            tmp[i].nextFree = (i+1<newcap) ? i+1 : -1;
+            tmp[i].history = nullptr;
+            tmp[i].since = 0;
+            tmp[i].row = -1;
+            tmp[i].grade = GRADE_NONE;
+        }
+        memDeleteArray(MEM_INDEX, slots, slotCap);
+        slots = tmp;
+        freeSlot = slotCap;
+        slotCap = newcap;
+    }
+    int s = freeSlot;
+    freeSlot = slots[s].nextFree;
+    return s;
+}
+
+Node* nodeOf(StudentHandle h) const {
+    if (h.slot < 0 || h.slot >= slotCap) return nullptr;
+    const Slot& sl = slots[h.slot];
+    if (!sl.node || sl.gen != h.gen) return nullptr;
+    return sl.node;
+}
+
+Node* findNode(const char* roll) const {
+    if (bloom) {
+        bloom->queries++;
+        if (!bloom->mayContain(roll)) { bloom->negatives++; return nullptr; }
+    }
+    Student* s = rollIndex.find(roll);
+    if (s) return slots[s->ownerSlot].node;
+    if (bloom) bloom->falsePositives++;
+    return nullptr;
+}
+
+// unlink and free a node in O(1)
+void unlink(Node* n) {
+    if (n->prev) n->prev->next = n->next; else head = n->next;
+    if (n->next) n->next->prev = n->prev;
+    Slot& sl = slots[n->slot];
+    sl.node = nullptr;
+    sl.gen++;
+    {
+        std::lock_guard<std::mutex> g(historyLock);
+        freeHistory(sl.history); // history goes with the student
+        sl.history = nullptr;
+    }
+    int moved = cols.remove(sl.row);
+    if (moved >= 0) slots[moved].row = sl.row;
+    sl.row = -1;
+    sl.nextFree = freeSlot;
+    freeSlot = n->slot;
+    if (bloom) bloom->remove(n->student->getRoll());
+    rollIndex.remove(n->student);
+    if (hist) hist->remove(n->student);
+    version++;
+    logMutation(n->student, MUT_REMOVE);
+    if (snap) { snap->set(n->slot, nullptr); snap->commit(version); }
+    delete n->student;
+    delete n;
+    count--;
+}
+
+// StudentObserver: keep indexes in sync when an owned student is edited
+void studentChanging(Student* s, StudentField f) override {
+    if (f == SF_ROLL && bloom) bloom->remove(s->getRoll());
+    if (f == SF_ROLL) rollIndex.remove(s);
+    if (f == SF_MARKS && historyOn) archiveMarks(s, clock());
+    if (hist && (f == SF_MARKS || f == SF_BRANCH || f == SF_LEVEL)) hist->remove(s);
+}
+void studentChanged(Student* s, StudentField f) override {
+    if (f == SF_ROLL && bloom) bloom->add(s->getRoll());
+    if (f == SF_ROLL) rollIndex.insert(s);
+    if (f == SF_MARKS) cols.set(slots[s->ownerSlot].row, s->marks);
+    if (hist && (f == SF_MARKS || f == SF_BRANCH || f == SF_LEVEL)) hist->add(s);
+    version++;
+    if (f == SF_NAME || f == SF_ROLL || f == SF_MARKS) logMutation(s, MUT_CHANGE);
+    if (snap) { snap->set(s->ownerSlot, s); snap->commit(version); }
+}
+
+public:
+Course(): head(nullptr), count(0), slots(nullptr), slotCap(0), freeSlot(-1), bloom(nullptr), snap(nullptr), hist(nullptr),
+          historyOn(false), retention(0), clock(systemMicros), gcStop(false), version(0),
+          mutHead(0), mutCount(0), mutFloor(0), viewRebuilds(0), viewPatches(0),
+          nbands(0), curveMode(CURVE_PERCENTILE), graded(false), gradedAt(0),
+          gradeFullPasses(0), gradeIncrementals(0) {
+    for (int k=0;k<SK_COUNT;k++) {
+        views[k].arr = nullptr;
+        views[k].n = views[k].cap = 0;
+        views[k].built = false;
+        views[k].builtAt = 0;
+    }
+}
+~Course() {
+stopHistoryGC();
+for (int i=0;i<slotCap;i++) freeHistory(slots[i].history);
+Node* cur = head;
+while (cur) {
+Node* nxt = cur->next;
+delete cur->student;
+delete cur;
+cur = nxt;
+}
+memDeleteArray(MEM_INDEX, slots, slotCap);
+if (bloom) delete bloom;
+if (snap) delete snap;
+if (hist) delete hist;
+for (int k=0;k<SK_COUNT;k++) memDeleteArray(MEM_VIEWS, views[k].arr, views[k].cap);
+}
+
+// add student (Course takes ownership). Use operator+=
+// returns a handle that stays valid until the student is removed
+StudentHandle operator+=(Student* s) {
+    Node* n = new Node(s);
+    s->setObserver(this);
+    if (bloom) bloom->add(s->getRoll());
+    rollIndex.insert(s);
+    if (hist) hist->add(s);
+    n->slot = acquireSlot();
+    s->ownerSlot = n->slot;
+    slots[n->slot].node = n;
+    slots[n->slot].since = clock();
+    slots[n->slot].row = cols.append(n->slot, s->marks);
+    // insert at head for simplicity
+    n->next = head;
+    if (head) head->prev = n;
+    head = n;
+    count++;
+    version++;
+    logMutation(s, MUT_ADD);
+    if (snap) { snap->set(n->slot, s); snap->commit(version); }
+    return StudentHandle(n->slot, slots[n->slot].gen);
+}
+
+// find student by roll. returns Student*, or nullptr
+Student* findByRoll(const char* roll) {
+    Node* n = findNode(roll);
+    return n ? n->student : nullptr;
+}
+
+// operator() to access/modify by roll number. Throws RollNotFoundException if not present.
+Student& operator()(const char* roll) {
+    Student* s = findByRoll(roll);
+    if (!s) throw RollNotFoundException();
+    return *s;
+}
+
+// resolve a handle. returns nullptr for stale or invalid handles
+Student* get(StudentHandle h) const {
+    Node* n = nodeOf(h);
+    return n ? n->student : nullptr;
+}
+
+// students with lo <= roll <= hi in roll order (null bound = open).
+// The range is invalidated by any change to the roster or to a roll.
+RollRange rangeByRoll(const char* lo, const char* hi) const { return rollIndex.range(lo, hi); }
+
+// students whose roll starts with prefix, in roll order
+RollRange rangeByRollPrefix(const char* prefix) const { return rollIndex.withPrefix(prefix); }
+
+// handle for a roll (index lookup), invalid handle if not present
+StudentHandle handleOf(const char* roll) const {
+    Node* n = findNode(roll);
+    if (!n) return StudentHandle();
+    return StudentHandle(n->slot, slots[n->slot].gen);
+}
+
+int size() const { return count; }
+
+// Students ordered by key (ties broken by roll). The array belongs to the
+// course and stays valid until the next mutation; its length is size().
+Student* const* sortedView(SortKey k) {
+    SortedView& v = views[k];
+    if (!v.built || v.builtAt != version) {
+        if (!v.built || !patchView(v, k)) rebuildView(v, k);
+        v.built = true;
+        v.builtAt = version;
+    }
+    return v.arr;
+}
+
+// mutation counter: changes whenever the roster or any record changes
+unsigned long long mutationVersion() const { return version; }
+
+// Apply many (roll, component, value) updates at once. Rolls are resolved
+// through one hashed pass over the roster instead of a scan per row, marks are
+// written in place, and dependent state is updated once for the whole batch.
+// Rows for unknown rolls are skipped and counted; later rows win on repeats.
+// Throws InvalidMarkComponentException, before anything is written, if any
+// row names a component outside MarkComponent.
+BatchResult applyMarkUpdates(const MarkUpdate* ups, int n) {
+    BatchResult res = {0, 0};
+    if (n <= 0) return res;
+    for (int i=0;i<n;i++)
+        if ((int)ups[i].component < 0 || (int)ups[i].component >= MC_COUNT)
+            throw InvalidMarkComponentException();
+    // open-addressing table roll -> Student*, load factor <= 0.5
+    int cap = 16;
+    while (cap < 2*count) cap <<= 1;
+    Student** table = memNewArray<Student*>(MEM_INDEX, cap);
+    for (int i=0;i<cap;i++) table[i] = nullptr;
+    for (Node* cur = head; cur; cur = cur->next) {
+        unsigned idx = (unsigned)hashRoll(cur->student->getRoll()) & (cap-1);
+        while (table[idx]) idx = (idx+1) & (cap-1);
+        table[idx] = cur->student;
+    }
+    Timestamp now = historyOn ? clock() : 0; // one timestamp for the whole batch
+    for (int i=0;i<n;i++) {
+        unsigned idx = (unsigned)hashRoll(ups[i].roll) & (cap-1);
+        Student* s = nullptr;
+        while (table[idx]) {
+            if (strcmp(table[idx]->roll, ups[i].roll) == 0) { s = table[idx]; break; }
+            idx = (idx+1) & (cap-1);
+        }
+        if (!s) { res.notFound++; continue; }
+        if (res.applied == 0) version++; // one version for the whole batch
+        if (historyOn) archiveMarks(s, now);
+        if (hist) hist->remove(s);
+        s->marks.at(ups[i].component) = ups[i].value;
+        cols.set(slots[s->ownerSlot].row, ups[i].component, ups[i].value);
+        if (hist) hist->add(s);
+        logMutation(s, MUT_CHANGE); // a batch larger than the log forces view rebuilds
+        if (snap) snap->set(s->ownerSlot, s);
+        res.applied++;
+    }
+    if (snap) snap->commit(version); // one published version per batch
+    memDeleteArray(MEM_INDEX, table, cap);
+    return res;
+}
+
+// Relative grading over totalMarks(): bands best first, e.g. {"A", 0.1},
+// {"B", 0.35}, ... {"F", 1} for percentiles, or z-scores for CURVE_STDDEV.
+// Grades are recomputed lazily on the next read after marks change.
+void setGradeCurve(const GradeBand* b, int n, CurveMode mode) {
+    if (n < 1 || n > GRADE_BANDS_MAX) throw BufferOverflowException();
+    for (int i=0;i<n;i++) bands[i] = b[i];
+    nbands = n;
+    curveMode = mode;
+    graded = false;
+}
+
+// letter grade of roll under the current curve. Throws RollNotFoundException
+const char* letterGrade(const char* roll) {
+    Node* nd = findNode(roll);
+    if (!nd) throw RollNotFoundException();
+    refreshGrades();
+    int g = nbands ? slots[nd->slot].grade : GRADE_NONE;
+    return g == GRADE_NONE ? "-" : bands[g].letter;
+}
+
+// students per band (counts has one entry per band); returns the band count
+int gradeDistribution(int* counts) {
+    refreshGrades();
+    for (int b=0;b<nbands;b++) counts[b] = 0;
+    for (Node* cur = head; cur; cur = cur->next) {
+        int g = slots[cur->slot].grade;
+        if (g != GRADE_NONE) counts[g]++;
+    }
+    return nbands;
+}
+
+// cut-off total of each band as last assigned; returns the band count
+int gradeCutoffs(double* cut) {
+    refreshGrades();
+    for (int b=0;b<nbands;b++) cut[b] = gradeCut[b];
+    return nbands;
+}
+
+// build a counting Bloom filter over the current rolls; lookups of absent
+// rolls are then rejected without scanning the list
+void enableRollFilter(int numCounters=1<<16, int numHashes=4) {
+    if (bloom) delete bloom;
+    bloom = new RollBloomFilter(numCounters, numHashes);
+    for (Node* cur = head; cur; cur = cur->next) bloom->add(cur->student->getRoll());
+}
+
+void disableRollFilter() {
+    if (bloom) delete bloom;
+    bloom = nullptr;
+}
+
+// keep per-component and total histograms (bin width 1 or 5) by branch and
+// level, updated with every add, removal and edit
+void enableHistograms(int binWidth=5) {
+    MarksHistograms* h = new MarksHistograms(binWidth);
+    if (hist) delete hist;
+    hist = h;
+    for (Node* cur = head; cur; cur = cur->next) hist->add(cur->student);
+}
+
+void disableHistograms() {
+    if (hist) delete hist;
+    hist = nullptr;
+}
+
+// distribution of a MarkComponent (or HIST_TOTAL), optionally for one branch
+// and/or level; O(bins). Histograms must be enabled (else all counts are 0)
+MarksHistogram histogram(int series, int branch = HIST_ANY, int level = HIST_ANY) const {
+    if (hist) return hist->read(series, branch, level);
+    MarksHistogram h;
+    memset(&h, 0, sizeof(h));
+    return h;
+}
+
+CourseStats stats() const {
+    CourseStats st;
+    st.students = count;
+    st.viewRebuilds = viewRebuilds;
+    st.viewPatches = viewPatches;
+    st.gradeFullPasses = gradeFullPasses;
+    st.gradeIncrementals = gradeIncrementals;
+    st.rollFilter = bloom != nullptr;
+    st.filterCounters = bloom ? bloom->numCounters() : 0;
+    st.filterHashes = bloom ? bloom->numHashes() : 0;
+    st.filterQueries = bloom ? bloom->queries : 0;
+    st.filterNegatives = bloom ? bloom->negatives : 0;
+    st.filterFalsePositives = bloom ? bloom->falsePositives : 0;
+    st.filterObservedFpr = bloom ? bloom->observedFpr() : 0.0;
+    st.filterEstimatedFpr = bloom ? bloom->estimatedFpr() : 0.0;
+    return st;
+}
+
+// Totals of every student from the marks columns (vectorised). out needs
+// size() entries; rows are in column order, which is insertion order except
+// that a removal moves the last row into the hole. who, if given, receives
+// the student of each row.
+int computeTotals(double* out, Student** who = nullptr) const {
+    int n = cols.size();
+    columnTotals(cols.columns(), out, n);
+    if (who) for (int r=0;r<n;r++) who[r] = slots[cols.slotOf(r)].node->student;
+    return n;
+}
+
+// totals under a grading scheme, in computeTotals() row order: compile-time
+// schemes use the specialised kernel, GradingScheme the runtime fallback
+template<class S> int computeTotals(double* out, Student** who = nullptr) const {
+    int n = cols.size();
+    schemeTotals<S>(cols.columns(), out, n);
+    if (who) for (int r=0;r<n;r++) who[r] = slots[cols.slotOf(r)].node->student;
+    return n;
+}
+int computeTotals(const GradingScheme& g, double* out, Student** who = nullptr) const {
+    int n = cols.size();
+    schemeTotals(g, cols.columns(), out, n);
+    if (who) for (int r=0;r<n;r++) who[r] = slots[cols.slotOf(r)].node->student;
+    return n;
+}
+
+// sum, mean, min, max and variance of each component and of the total
+MarksAggregate aggregate() const {
+    MarksAggregate ag;
+    int n = cols.size();
+    ag.count = n;
+    for (int c=0;c<MC_COUNT;c++) ag.component[c] = columnStats(cols.column((MarkComponent)c), n);
+    double* totals = memNewArray<double>(MEM_COLUMNS, n);
+    columnTotals(cols.columns(), totals, n);
+    ag.total = columnStats(totals, n);
+    memDeleteArray(MEM_COLUMNS, totals, n);
+    return ag;
+}
+
+// export to array (array of Student*) for sorting
+// release with releaseStudentArray(arr, size()) so memory accounting stays exact
+Student** exportArray() {
+    if (count == 0) return nullptr;
+    Student** arr = memNewArray<Student*>(MEM_EXPORT, count);
+    int idx = 0;
+    Node* cur = head;
+    while (cur) {
+        arr[idx++] = cur->student;
+        cur = cur->next;
+    }
+    return arr;
+}
+
+// Keep old marks versions for time-travel reads. Versions that stopped being
+// current more than retentionMicros ago are dropped by collectHistory().
+void enableHistory(Timestamp retentionMicros) {
+    historyOn = true;
+    retention = retentionMicros;
+}
+
+// clock used for version timestamps (tests and replays can pin time)
+void setClock(Timestamp (*fn)()) { clock = fn ? fn : systemMicros; }
+
+CourseAsOf asOf(Timestamp ts) { return CourseAsOf(*this, ts); }
+
+// marks of roll at ts; false if there is no such student or version
+bool marksAt(const char* roll, Timestamp ts, Marks& out) {
+    Node* n = findNode(roll);
+    if (!n) return false;
+    const Slot& sl = slots[n->slot];
+    if (ts >= sl.since) { out = n->student->marks; return true; }
+    std::lock_guard<std::mutex> g(historyLock);
+    for (MarksVersion* v = sl.history; v; v = v->older) {
+        if (ts >= v->validFrom && ts < v->validTo) { out = v->marks; return true; }
+        if (ts >= v->validTo) break;
+    }
+    return false;
+}
+
+// drop versions that ended before now - retention; returns versions freed
+int collectHistory() {
+    Timestamp cutoff = clock() - retention;
+    int freed = 0;
+    std::lock_guard<std::mutex> g(historyLock);
+    for (int i=0;i<slotCap;i++) {
+        MarksVersion** link = &slots[i].history;
+        while (*link && (*link)->validTo >= cutoff) link = &(*link)->older;
+        // chains are newest first: everything from here on is older
+        for (MarksVersion* v = *link; v; v = v->older) freed++;
+        freeHistory(*link);
+        *link = nullptr;
+    }
+    return freed;
+}
+
+// run collectHistory() every intervalMs on a background thread
+void startHistoryGC(int intervalMs) {
+    stopHistoryGC();
+    gcStop = false;
+    gcThread = std::thread([this, intervalMs]() {
+        std::unique_lock<std::mutex> lk(gcWaitLock);
+        while (!gcWake.wait_for(lk, std::chrono::milliseconds(intervalMs), [this]() { return gcStop; })) {
+            lk.unlock();
+            collectHistory();
+            lk.lock();
+        }
+    });
+}
+
+void stopHistoryGC() {
+    if (!gcThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lk(gcWaitLock);
+        gcStop = true;
+    }
+    gcWake.notify_all();
+    gcThread.join();
+}
+
+// Snapshot mode: publish immutable roster versions so SnapshotReaders on
+// other threads can scan without locks while this course is being modified.
+void enableSnapshots() {
+    if (snap) return;
+    snap = new RosterPublisher();
+    for (Node* cur = head; cur; cur = cur->next) snap->set(cur->slot, cur->student);
+    snap->commit(version);
+}
+
+// no SnapshotReader may be open on this course
+void disableSnapshots() {
+    if (snap) delete snap;
+    snap = nullptr;
+}
+
+bool snapshotsEnabled() const { return snap != nullptr; }
+
+// source for SnapshotReader; requires enableSnapshots()
+const RosterPublisher& snapshots() const {
+    if (!snap) throw StudentException("Snapshots not enabled");
+    return *snap;
+}
+
+// copy a consistent snapshot into out (capacity cap); returns records copied
+int exportSnapshot(StudentRecord* out, int cap) const {
+    SnapshotReader r(snapshots());
+    int n = 0;
+    r.forEach([&](const StudentRecord& rec) { if (n < cap) out[n++] = rec; });
+    return n;
+}
+
+// print all (from a consistent snapshot, in slot order, when snapshots are enabled)
+void printAll() const {
+    if (snap) {
+        SnapshotReader r(*snap);
+        r.forEach(printRecord);
+        return;
+    }
+    Node* cur = head;
+    while (cur) {
+        cur->student->print();
+        cur = cur->next;
+    }
+}
+
+// remove student by handle in O(1). returns false for stale handles
+bool remove(StudentHandle h) {
+    Node* n = nodeOf(h);
+    if (!n) return false;
+    unlink(n);
+    return true;
+}
+
+// remove student by roll (thin wrapper: look up the handle, then O(1) unlink)
+bool removeByRoll(const char* roll) {
+    return remove(handleOf(roll));
+}
+
+};
+
+Marks CourseAsOf::operator()(const char* roll) const {
+Marks m;
+if (!course.marksAt(roll, ts, m)) throw RollNotFoundException();
+return m;
+}
+
+/* -------------------------
+Concurrent course backing: lock-free skiplist ordered by roll
+An alternative to Course for bursts of parallel registrations. Inserts link
+a node level by level with compare-and-swap, so intake threads never take a
+lock and only contend where they insert next to each other; lookups are
+plain atomic loads, and a level-0 walk yields students in roll order with no
+separate sort. Entries are keyed by (roll, Student address), so duplicate
+rolls stay distinct as in Course.
+
+Removal (Harris-style): remove() detaches the student, which it retires
+through the EpochManager, then sets the low bit of each of the node's next
+pointers. Any search that meets a marked node snips it out, and inserts never
+link behind one. An insert that was already in flight may still link a
+marked node back in, so the node waits on a pending list until every reader
+pinned at removal time has left; a final search then unlinks it for good and
+it is retired like the student. Readers only touch a student while their
+epoch is pinned: use a Pinned from findByRoll()/operator(), withStudent(),
+forEach(), or hold an EpochGuard around exportSorted() and its results.
+Each node keeps its own copy of the roll; edit a student's roll only by
+removing and re-adding it.
+------------------------- */
+
+const int SKIP_MAX_LEVEL = 16;
+
+struct SkipNode {
+char roll[ROLL_MAX];
+unsigned long long tie;             // Student address at insertion
+std::atomic<Student*> student;      // nullptr once removed
+int height;
+std::atomic<SkipNode*> next[1];     // really next[height]; low bit = removed
+
+static SkipNode* create(const char* roll, unsigned long long tie, Student* s, int h) {
+    size_t sz = sizeof(SkipNode) + (h-1)*sizeof(std::atomic<SkipNode*>);
+    void* mem = ::operator new(sz);
+    memAlloc(MEM_NODES, sz);
+    SkipNode* nd = (SkipNode*)mem;
+    strcpy(nd->roll, roll);
+    nd->tie = tie;
+    new (&nd->student) std::atomic<Student*>(s);
+    nd->height = h;
+    for (int i=0;i<h;i++) new (&nd->next[i]) std::atomic<SkipNode*>(nullptr);
+    return nd;
+}
+static void destroy(SkipNode* nd) {
+    memFree(MEM_NODES, sizeof(SkipNode) + (nd->height-1)*sizeof(std::atomic<SkipNode*>));
+    ::operator delete(nd);
+}
+static bool marked(SkipNode* p) { return ((size_t)p & 1) != 0; }
+static SkipNode* unmarked(SkipNode* p) { return (SkipNode*)((size_t)p & ~(size_t)1); }
+static SkipNode* withMark(SkipNode* p) { return (SkipNode*)((size_t)p | 1); }
+};
+
+void deleteStudent(void* p) { delete (Student*)p; }
+void deleteSkipNode(void* p) { SkipNode::destroy((SkipNode*)p); }
+
+class ConcurrentCourse {
+private:
+// removed node that may still be linked, and the epoch it was removed in
+struct PendingNode {
+SkipNode* node;
+unsigned long long epoch;
+};
+
+SkipNode* head;  // sentinel, full height, sorts before everything
+std::atomic<int> count;
+std::mutex pendingLock;
+PendingNode* pending;
+int npending, pendingCap;
+
+ConcurrentCourse(const ConcurrentCourse&) = delete;
+ConcurrentCourse& operator=(const ConcurrentCourse&) = delete;
+
+// is node before (roll, tie)?
+static bool before(const SkipNode* nd, const char* roll, unsigned long long tie) {
+    int c = strcmp(nd->roll, roll);
+    return c < 0 || (c == 0 && nd->tie < tie);
+}
+
+static int randomHeight() {
+    static thread_local unsigned long long x = 0;
+    if (!x) x = mix64((unsigned long long)(size_t)&x ^ (unsigned long long)systemMicros()) | 1;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    int h = 1;
+    unsigned long long bits = x;
+    while (h < SKIP_MAX_LEVEL && (bits & 3) == 0) { h++; bits >>= 2; } // p = 1/4
+    return h;
+}
+
+// preds[i]/succs[i]: unmarked nodes around (roll, tie) on each level.
+// Marked nodes met on the way are snipped out. Caller holds the epoch.
+void findSplice(const char* roll, unsigned long long tie, SkipNode** preds, SkipNode** succs) const {
+retry:
+    SkipNode* pred = head;
+    for (int lv=SKIP_MAX_LEVEL-1; lv>=0; lv--) {
+        SkipNode* cur = SkipNode::unmarked(pred->next[lv].load(std::memory_order_acquire));
+        while (cur) {
+            SkipNode* succ = cur->next[lv].load(std::memory_order_acquire);
+            if (SkipNode::marked(succ)) {
+                // fails if pred is being removed too, or pred->next moved on
+                SkipNode* expect = cur;
+                if (!pred->next[lv].compare_exchange_strong(expect, SkipNode::unmarked(succ))) goto retry;
+                cur = SkipNode::unmarked(succ);
+                continue;
+            }
+            if (!before(cur, roll, tie)) break;
+            pred = cur;
+            cur = succ;
+        }
+        preds[lv] = pred;
+        succs[lv] = cur;
+    }
+}
+
+// first live node with this roll. Caller holds the epoch
+SkipNode* findNode(const char* roll) const {
+    SkipNode* preds[SKIP_MAX_LEVEL];
+    SkipNode* succs[SKIP_MAX_LEVEL];
+    findSplice(roll, 0, preds, succs);
+    for (SkipNode* nd = succs[0]; nd && strcmp(nd->roll, roll) == 0;
+         nd = SkipNode::unmarked(nd->next[0].load(std::memory_order_acquire))) {
+        if (nd->student.load(std::memory_order_acquire)) return nd;
+    }
+    return nullptr;
+}
+
+// set the removed bit on every level of nd, top down
+static void markNode(SkipNode* nd) {
+    for (int lv=nd->height-1; lv>=0; lv--) {
+        SkipNode* nxt = nd->next[lv].load();
+        while (!SkipNode::marked(nxt) && !nd->next[lv].compare_exchange_weak(nxt, SkipNode::withMark(nxt))) {}
+    }
+}
+
+// unlink and retire pending nodes whose removal every reader has seen
+void collectPending() {
+    std::lock_guard<std::mutex> g(pendingLock);
+    EpochManager& em = EpochManager::instance();
+    SkipNode* preds[SKIP_MAX_LEVEL];
+    SkipNode* succs[SKIP_MAX_LEVEL];
+    int w = 0;
+    for (int i=0;i<npending;i++) {
+        SkipNode* nd = pending[i].node;
+        if (!em.quiescent(pending[i].epoch)) { pending[w++] = pending[i]; continue; }
+        em.enter();
+        findSplice(nd->roll, nd->tie, preds, succs); // snips any link an old insert restored
+        em.exit();
+        em.retire(nd, deleteSkipNode);
+    }
+    npending = w;
+}
+
+public:
+// A student found by roll, with the calling thread's epoch pinned: it is not
+// freed while the Pinned lives, even if another thread removes it. Use and
+// destroy it on the thread that created it.
+class Pinned {
+private:
+EpochGuard guard;
+Student* s;
+Pinned(const Pinned&) = delete;
+Pinned& operator=(const Pinned&) = delete;
+public:
+Pinned(const ConcurrentCourse& c, const char* roll, bool required=false) {
+    SkipNode* nd = c.findNode(roll);
+    s = nd ? nd->student.load(std::memory_order_acquire) : nullptr;
+    if (!s && required) throw RollNotFoundException(); // guard unpins
+}
+Student* get() const { return s; }
+Student* operator->() const { return s; }
+Student& operator*() const { return *s; }
+explicit operator bool() const { return s != nullptr; }
+};
+
+ConcurrentCourse(): count(0), pending(nullptr), npending(0), pendingCap(0) {
+    head = SkipNode::create("", 0, nullptr, SKIP_MAX_LEVEL);
+}
+// no other thread may use the course while it is destroyed
+~ConcurrentCourse() {
+    SkipNode* preds[SKIP_MAX_LEVEL];
+    SkipNode* succs[SKIP_MAX_LEVEL];
+    // nothing is in flight now, so one search unlinks each pending node
+    for (int i=0;i<npending;i++) {
+        findSplice(pending[i].node->roll, pending[i].node->tie, preds, succs);
+        SkipNode::destroy(pending[i].node);
+    }
+    memDeleteArray(MEM_NODES, pending, pendingCap);
+    SkipNode* nd = head;
+    while (nd) {
+        SkipNode* nxt = SkipNode::unmarked(nd->next[0].load());
+        Student* s = nd->student.load();
+        if (s) delete s;
+        SkipNode::destroy(nd);
+        nd = nxt;
+    }
+}
+
+// add student (takes ownership); safe to call from many threads at once
+ConcurrentCourse& operator+=(Student* s) {
+    const char* roll = s->getRoll();
+    unsigned long long tie = (unsigned long long)(size_t)s;
+    int h = randomHeight();
+    SkipNode* nd = SkipNode::create(roll, tie, s, h);
+    SkipNode* preds[SKIP_MAX_LEVEL];
+    SkipNode* succs[SKIP_MAX_LEVEL];
+    EpochGuard guard;
+    // level 0 makes the student visible; upper levels are shortcuts
+    for (;;) {
+        findSplice(roll, tie, preds, succs);
+        nd->next[0].store(succs[0], std::memory_order_relaxed);
+        SkipNode* expect = succs[0];
+        if (preds[0]->next[0].compare_exchange_strong(expect, nd, std::memory_order_release)) break;
+    }
+    count.fetch_add(1, std::memory_order_relaxed);
+    for (int lv=1; lv<h; lv++) {
+        for (;;) {
+            // a concurrent remove marks our next pointers: stop linking then
+            SkipNode* mine = nd->next[lv].load();
+            if (SkipNode::marked(mine)) return *this;
+            if (mine != succs[lv] && !nd->next[lv].compare_exchange_strong(mine, succs[lv])) return *this;
+            SkipNode* expect = succs[lv];
+            if (preds[lv]->next[lv].compare_exchange_strong(expect, nd, std::memory_order_release)) break;
+            findSplice(roll, tie, preds, succs);
+        }
+    }
+    return *this;
+}
+
+// find student by roll; test the result before use
+Pinned findByRoll(const char* roll) const { return Pinned(*this, roll); }
+
+// operator() to access/modify by roll number. Throws RollNotFoundException if not present.
+Pinned operator()(const char* roll) const { return Pinned(*this, roll, true); }
+
+// call fn(Student*) with the student of roll while it is pinned; false if absent
+template<class Fn> bool withStudent(const char* roll, Fn fn) const {
+    Pinned p(*this, roll);
+    if (!p) return false;
+    fn(p.get());
+    return true;
+}
+
+// detach and retire the student and unlink its node. A student stays valid
+// for readers that pinned it before the removal until they unpin.
+bool removeByRoll(const char* roll) {
+    EpochManager& em = EpochManager::instance();
+    SkipNode* removed = nullptr;
+    {
+        EpochGuard guard;
+        while (!removed) {
+            SkipNode* nd = findNode(roll);
+            if (!nd) break;
+            Student* s = nd->student.load(std::memory_order_acquire);
+            if (s && nd->student.compare_exchange_strong(s, nullptr)) {
+                em.retire(s, deleteStudent);
+                markNode(nd);
+                SkipNode* preds[SKIP_MAX_LEVEL];
+                SkipNode* succs[SKIP_MAX_LEVEL];
+                findSplice(nd->roll, nd->tie, preds, succs);
+                removed = nd;
+            }
+        }
+    }
+    if (!removed) return false;
+    count.fetch_sub(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> g(pendingLock);
+        if (npending == pendingCap) {
+            int newcap = pendingCap ? pendingCap*2 : 16;
+            PendingNode* tmp = memNewArray<PendingNode>(MEM_NODES, newcap);
+            for (int i=0;i<npending;i++) tmp[i] = pending[i];
+            memDeleteArray(MEM_NODES, pending, pendingCap);
+            pending = tmp;
+            pendingCap = newcap;
+        }
+        pending[npending].node = removed;
+        pending[npending].epoch = em.advance();
+        npending++;
+    }
+    collect();
+    return true;
+}
+
+// free what removals left behind that no reader can reach any more; also
+// run by removeByRoll(). Call from a thread that holds no pin.
+void collect() {
+    collectPending();
+    EpochManager::instance().reclaim();
+}
+
+// removed nodes not yet unlinked for good
+int pendingNodes() {
+    std::lock_guard<std::mutex> g(pendingLock);
+    return npending;
+}
+
+int size() const { return count.load(std::memory_order_relaxed); }
+
+// call fn(Student*) for every student in roll order
+template<class Fn> void forEach(Fn fn) const {
+    EpochGuard guard;
+    for (SkipNode* nd = SkipNode::unmarked(head->next[0].load(std::memory_order_acquire)); nd;
+         nd = SkipNode::unmarked(nd->next[0].load(std::memory_order_acquire))) {
+        Student* s = nd->student.load(std::memory_order_acquire);
+        if (s) fn(s);
+    }
+}
+
+// students in roll order; out must hold cap entries. returns the count written.
+// With concurrent removals the pointers are only safe while the caller holds
+// an EpochGuard taken before the call.
+int exportSorted(Student** out, int cap) const {
+    int n = 0;
+    forEach([&](Student* s) { if (n < cap) out[n++] = s; });
+    return n;
+}
+
+void printAll() const {
+    forEach([](Student* s) { s->print(); });
+}
+
+};
+
+/* -------------------------
+Sorting utilities
+
+* Sort by roll (lexicographic)
+* Sort by marks component (assignment|midterm|lab|final)
+* Sort by name using Trie
+  No STL: implement quicksort on array of Student*
+  ------------------------- */
+
+int cmpRoll(const char* a, const char* b) {
+return strcmp(a,b);
+}
+
+double getComponent(const Student* s, MarkComponent mc) {
+return s->getMarks().at(mc);
+}
+
+/* quicksort for Student* array using comparator function */
+typedef int (*CmpFn)(Student*, Student*);
+
+int cmpByRollPtr(Student* a, Student* b) {
+return strcmp(a->getRoll(), b->getRoll());
+}
+
+int cmpByMarksPtrFactory(Student* a, Student* b, MarkComponent mc) {
+double da = getComponent(a, mc);
+double db = getComponent(b, mc);
+if (da < db) return -1;
+if (da > db) return 1;
+return strcmp(a->getRoll(), b->getRoll()); // tie-breaker
+}
+
+void quickSwap(Student** arr, int i, int j) {
+Student* t = arr[i]; arr[i]=arr[j]; arr[j]=t;
+}
+
+/* quicksort by roll */
+void quickSortRoll(Student** arr, int lo, int hi) {
+if (lo >= hi) return;
+Student* pivot = arr[(lo+hi)/2];
+int i = lo, j = hi;
+while (i <= j) {
+while (strcmp(arr[i]->getRoll(), pivot->getRoll()) < 0) i++;
+while (strcmp(arr[j]->getRoll(), pivot->getRoll()) > 0) j--;
+if (i <= j) {
+quickSwap(arr, i, j);
+i++; j--;
+}
+}
+if (lo < j) quickSortRoll(arr, lo, j);
+if (i < hi) quickSortRoll(arr, i, hi);
+}
+
+/* quicksort by marks component */
+void quickSortMarks(Student** arr, int lo, int hi, MarkComponent mc) {
+if (lo >= hi) return;
+double pivotVal = getComponent(arr[(lo+hi)/2], mc);
+int i = lo, j = hi;
+while (i <= j) {
+while (getComponent(arr[i], mc) < pivotVal) i++;
+while (getComponent(arr[j], mc) > pivotVal) j--;
+if (i <= j) {
+quickSwap(arr, i, j);
+i++; j--;
+}
+}
+if (lo < j) quickSortMarks(arr, lo, j, mc);
+if (i < hi) quickSortMarks(arr, i, hi, mc);
+}
+
+/* -------------------------
+Stable sorting mode
+quickSortRoll/quickSortMarks are unstable: equal keys come out in an order
+that depends on the partitioning. SORT_STABLE uses a merge sort that keeps
+equal keys in input order, so repeated exports of the same roster are
+byte-identical. The scratch buffer can be reused across sorts.
+------------------------- */
+
+enum SortMode { SORT_FAST=0, SORT_STABLE=1 };
+
+class SortScratch {
+private:
+Student** buf;
+int cap;
+SortScratch(const SortScratch&) = delete;
+SortScratch& operator=(const SortScratch&) = delete;
+public:
+SortScratch(): buf(nullptr), cap(0) {}
+~SortScratch() { memDeleteArray(MEM_SORT, buf, cap); }
+Student** get(int n) {
+    if (n > cap) {
+        memDeleteArray(MEM_SORT, buf, cap);
+        cap = n;
+        buf = memNewArray<Student*>(MEM_SORT, cap);
+    }
+    return buf;
+}
+};
+
+const int MERGE_INSERTION_CUTOFF = 16;
+
+/* stable merge sort of arr[lo..hi) on the key only; tmp has room for hi-lo entries */
+void mergeSortByKey(Student** arr, Student** tmp, int lo, int hi, SortKey k) {
+if (hi - lo <= MERGE_INSERTION_CUTOFF) {
+    for (int i=lo+1;i<hi;i++) {
+        Student* s = arr[i];
+        int j = i-1;
+        while (j >= lo && compareKey(arr[j], s, k) > 0) { arr[j+1] = arr[j]; j--; }
+        arr[j+1] = s;
+    }
+    return;
+}
+int mid = lo + (hi-lo)/2;
+mergeSortByKey(arr, tmp, lo, mid, k);
+mergeSortByKey(arr, tmp, mid, hi, k);
+if (compareKey(arr[mid-1], arr[mid], k) <= 0) return; // already in order
+int i = lo, j = mid, o = 0;
+while (i < mid && j < hi) {
+    // take from the left run on ties to stay stable
+    if (compareKey(arr[j], arr[i], k) < 0) tmp[o++] = arr[j++]; else tmp[o++] = arr[i++];
+}
+while (i < mid) tmp[o++] = arr[i++];
+while (j < hi) tmp[o++] = arr[j++];
+memcpy(arr+lo, tmp, o*sizeof(Student*));
+}
+
+/* sort arr[0..n) by key; scratch is only used (and may be null) for SORT_STABLE */
+void sortStudents(Student** arr, int n, SortKey k, SortMode mode, SortScratch* scratch=nullptr) {
+if (n < 2) return;
+if (mode == SORT_STABLE) {
+    SortScratch local;
+    Student** tmp = (scratch ? scratch : &local)->get(n);
+    mergeSortByKey(arr, tmp, 0, n, k);
+    return;
+}
+switch(k) {
+case SK_ROLL: quickSortRoll(arr, 0, n-1); break;
+case SK_ASSIGN: case SK_MID: case SK_LAB: case SK_FINAL:
+    quickSortMarks(arr, 0, n-1, (MarkComponent)(k - SK_ASSIGN)); break;
+default: quickSortByKey(arr, 0, n-1, k); break;
+}
+}
+
+/* -------------------------
+Trie for name sorting
+
+* store pointers to Student at terminal nodes
+* traverse trie in lexicographic order
+* nodes live in one arena and refer to each other by 32-bit index, so
+  building is bump allocation and teardown is a single free; students at a
+  node are chained through a second arena in insertion order
+  ------------------------- */
+
+const unsigned TRIE_NONE = 0; // node 0 is the root, never anyone's child
+const long long FUZZY_BUDGET_US = 5000; // default latency budget of fuzzySearch()
+
+struct TrieNode {
+unsigned children[TRIE_ALPHABET]; // arena indices, TRIE_NONE if absent
+unsigned occupancy; // bit i set <=> children[i] != TRIE_NONE
+unsigned firstStud; // head/tail of this node's student chain, TRIE_NONE if empty
+unsigned lastStud;
+};
+
+struct TrieStudent {
+Student* student;
+unsigned next;      // next student with the same name, TRIE_NONE at the end
+};
+
+/* one result of NameTrie::fuzzySearch() */
+struct FuzzyMatch {
+Student* student;
+int distance;       // Levenshtein distance from the query, in chIndex collation
+};
+
+/* growable slab of T addressed by index; index 0 is reserved */
+template<class T, MemSubsystem M> class TrieArena {
+private:
+T* items;
+unsigned used;
+unsigned cap;
+TrieArena(const TrieArena&) = delete;
+TrieArena& operator=(const TrieArena&) = delete;
+public:
+TrieArena(unsigned reserve): used(1), cap(reserve < 16 ? 16 : reserve) {
+    items = memNewArray<T>(M, cap);
+}
+~TrieArena() { memDeleteArray(M, items, cap); }
+unsigned alloc() {
+    if (used == cap) {
+        unsigned newcap = cap*2;
+        T* tmp = memNewArray<T>(M, newcap);
+        memcpy(tmp, items, used*sizeof(T));
+        memDeleteArray(M, items, cap);
+        items = tmp;
+        cap = newcap;
+    }
+    return used++;
+}
+T& operator[](unsigned i) { return items[i]; }
+const T& operator[](unsigned i) const { return items[i]; }
+unsigned size() const { return used; }
+};
+
+class NameTrie {
+private:
+TrieArena<TrieNode, MEM_TRIE_NODES> nodes;
+TrieArena<TrieStudent, MEM_TRIE_ARRAYS> studs;
+unsigned rootIdx;
+
+unsigned newNode() {
+    unsigned i = nodes.alloc();
+    TrieNode& nd = nodes[i];
+    for (int c=0;c<TRIE_ALPHABET;c++) nd.children[c] = TRIE_NONE;
+    nd.occupancy = 0;
+    nd.firstStud = nd.lastStud = TRIE_NONE;
+    return i;
+}
+
+public:
+// expectedNames sizes the arenas up front (they still grow if needed)
+NameTrie(int expectedNames=0)
+    : nodes((unsigned)(expectedNames > 0 ? expectedNames*4 : 64)),
+      studs((unsigned)(expectedNames > 0 ? expectedNames+1 : 16)) {
+    // slot 0 of the arena is the reserved TRIE_NONE; the root takes the next one
+    rootIdx = newNode();
+}
+
+unsigned root() const { return rootIdx; }
+const TrieNode& node(unsigned i) const { return nodes[i]; }
+const TrieStudent& studentEntry(unsigned i) const { return studs[i]; }
+unsigned nodeCount() const { return nodes.size() - 1; }
+
+void insert(Student* s) {
+    const char* name = s->getName();
+    unsigned cur = rootIdx;
+    int n = strlen(name);
+    for (int i=0;i<n;i++) {
+        int idx = chIndex(name[i]);
+        unsigned nxt = nodes[cur].children[idx];
+        if (nxt == TRIE_NONE) {
+            nxt = newNode(); // may move the arena: re-index, don't hold references
+            nodes[cur].children[idx] = nxt;
+            nodes[cur].occupancy |= 1u << idx;
+        }
+        cur = nxt;
+    }
+    unsigned e = studs.alloc();
+    studs[e].student = s;
+    studs[e].next = TRIE_NONE;
+    TrieNode& nd = nodes[cur];
+    if (nd.lastStud == TRIE_NONE) nd.firstStud = e; else studs[nd.lastStud].next = e;
+    nd.lastStud = e;
+}
+
+// Iterative, allocation-free traversal: calls fn(Student*) in sorted order.
+// An explicit stack (one frame per name character, bounded by NAME_MAX)
+// replaces recursion, and children are visited through the occupancy
+// bitmap with count-trailing-zeros, so empty slots are never looked at.
+template<class Fn> void forEachSorted(Fn fn) const {
+    struct Frame {
+        unsigned node;
+        unsigned pending; // children not visited yet
+    };
+    Frame stack[NAME_MAX+1];
+    int top = 0;
+    for (unsigned e = nodes[rootIdx].firstStud; e != TRIE_NONE; e = studs[e].next) fn(studs[e].student);
+    stack[0].node = rootIdx;
+    stack[0].pending = nodes[rootIdx].occupancy;
+    while (top >= 0) {
+        Frame& f = stack[top];
+        if (!f.pending) { top--; continue; }
+        int c = __builtin_ctz(f.pending);
+        f.pending &= f.pending - 1;
+        unsigned child = nodes[f.node].children[c];
+        const TrieNode& cn = nodes[child];
+        for (unsigned e = cn.firstStud; e != TRIE_NONE; e = studs[e].next) fn(studs[e].student);
+        if (cn.occupancy) {
+            top++;
+            stack[top].node = child;
+            stack[top].pending = cn.occupancy;
+        }
+    }
+}
+
+// write up to cap students in sorted order into out; returns the count written
+int collectInto(Student** out, int cap) const {
+    int idx = 0;
+    forEachSorted([&](Student* s) { if (idx < cap) out[idx++] = s; });
+    return idx;
+}
+
+// produce sorted array of size 'count'. Caller must ensure out has capacity count.
+void collectSorted(Student** out, int count) {
+    collectInto(out, count);
+}
+
+// Approximate lookup: the best maxResults students whose names are within
+// maxDist edits (Levenshtein, chIndex collation) of query, closest first,
+// ties in name order. Walks the trie depth-first carrying one DP row per
+// level, so a subtree is skipped as soon as its row minimum exceeds the
+// bound; once out is full the bound tightens to beat the worst kept match.
+// Stops after budgetMicros, with *complete (if given) set to false.
+int fuzzySearch(const char* query, int maxDist, FuzzyMatch* out, int maxResults,
+                long long budgetMicros = FUZZY_BUDGET_US, bool* complete = nullptr) const {
+    int m = strlen(query);
+    if (m >= NAME_MAX) throw BufferOverflowException();
+    if (complete) *complete = true;
+    if (maxResults <= 0 || maxDist < 0) return 0;
+    int q[NAME_MAX];
+    for (int j=0;j<m;j++) q[j] = chIndex(query[j]);
+    int rows[NAME_MAX+1][NAME_MAX+1]; // rows[d]: DP row for the node at depth d
+    for (int j=0;j<=m;j++) rows[0][j] = j;
+    int found = 0;
+    int bound = maxDist;
+    auto offer = [&](unsigned nd, int dist) {
+        for (unsigned e = nodes[nd].firstStud; e != TRIE_NONE; e = studs[e].next) {
+            if (found == maxResults && dist >= out[found-1].distance) return;
+            int pos = found < maxResults ? found++ : found - 1;
+            while (pos > 0 && out[pos-1].distance > dist) { out[pos] = out[pos-1]; pos--; }
+            out[pos].student = studs[e].student;
+            out[pos].distance = dist;
+        }
+        if (found == maxResults) bound = out[found-1].distance - 1;
+    };
+    if (rows[0][m] <= bound) offer(rootIdx, rows[0][m]);
+
+    struct Frame {
+        unsigned node;
+        unsigned pending;
+    };
+    Frame stack[NAME_MAX+1];
+    int top = 0;
+    stack[0].node = rootIdx;
+    stack[0].pending = nodes[rootIdx].occupancy;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(budgetMicros);
+    unsigned visited = 0;
+    while (top >= 0 && bound >= 0) {
+        if ((++visited & 1023) == 0 && std::chrono::steady_clock::now() > deadline) {
+            if (complete) *complete = false;
+            break;
+        }
+        Frame& f = stack[top];
+        if (!f.pending) { top--; continue; }
+        int c = __builtin_ctz(f.pending);
+        f.pending &= f.pending - 1;
+        unsigned child = nodes[f.node].children[c];
+        const int* prev = rows[top];
+        int* cur = rows[top+1];
+        cur[0] = prev[0] + 1;
+        int rowMin = cur[0];
+        for (int j=1;j<=m;j++) {
+            int v = prev[j-1] + (q[j-1] != c);
+            if (prev[j] + 1 < v) v = prev[j] + 1;
+            if (cur[j-1] + 1 < v) v = cur[j-1] + 1;
+            cur[j] = v;
+            if (v < rowMin) rowMin = v;
+        }
+        if (cur[m] <= bound) offer(child, cur[m]);
+        if (rowMin <= bound && nodes[child].occupancy && top+1 < NAME_MAX) {
+            top++;
+            stack[top].node = child;
+            stack[top].pending = nodes[child].occupancy;
+        }
+    }
+    return found;
+}
+
+};
+
+/* -------------------------
+Burstsort name engine
+A shallow trie whose leaves are buckets of name pointers. Names are
+appended to the bucket for their next character; a bucket that outgrows
+BURST_LIMIT bursts into a subtrie one character deeper. Finished buckets
+are small enough to stay in cache and are sorted with a multikey quicksort
+over 8 collated bytes cached next to each pointer, so most comparisons
+never touch the Student. Collation is chIndex (code = chIndex + 1, 0 at
+the end of the name); equal names keep export order, as in the trie.
+------------------------- */
+
+const int BURST_LIMIT = 1024; // bucket entries before it bursts
+
+struct BurstEntry {
+unsigned long long key; // next 8 codes from the sort depth, big-endian
+Student* student;
+const char* name;
+unsigned pos;           // export position, the tie-break for equal names
+};
+
+/* pack up to 8 codes of name starting at depth (name has at least depth chars) */
+inline unsigned long long nameKey8(const char* name, int depth) {
+unsigned long long k = 0;
+const char* p = name + depth;
+for (int i=0;i<8;i++) {
+    k <<= 8;
+    if (*p) k |= (unsigned long long)(chIndex(*p++) + 1);
+}
+return k;
+}
+
+struct BurstBucket {
+BurstEntry* items;
+int n;
+int cap;
+};
+
+struct BurstNode {
+BurstNode* sub[TRIE_ALPHABET];      // burst children
+BurstBucket* bucket[TRIE_ALPHABET]; // leaf buckets (at most one of sub/bucket set)
+BurstBucket ends;                    // names that end at this node, in export order
+};
+
+inline void burstAppend(BurstBucket& b, const BurstEntry& e) {
+if (b.n == b.cap) {
+    int newcap = b.cap ? b.cap*2 : 16;
+    BurstEntry* tmp = memNewArray<BurstEntry>(MEM_SORT, newcap);
+    for (int i=0;i<b.n;i++) tmp[i] = b.items[i];
+    memDeleteArray(MEM_SORT, b.items, b.cap);
+    b.items = tmp;
+    b.cap = newcap;
+}
+b.items[b.n++] = e;
+}
+
+inline BurstNode* burstNewNode() {
+BurstNode* nd = memNewArray<BurstNode>(MEM_SORT, 1);
+for (int c=0;c<TRIE_ALPHABET;c++) { nd->sub[c] = nullptr; nd->bucket[c] = nullptr; }
+nd->ends.items = nullptr;
+nd->ends.n = nd->ends.cap = 0;
+return nd;
+}
+
+inline void burstFreeBucket(BurstBucket* b) {
+memDeleteArray(MEM_SORT, b->items, b->cap);
+memDeleteArray(MEM_SORT, b, 1);
+}
+
+void burstFreeNode(BurstNode* nd) {
+for (int c=0;c<TRIE_ALPHABET;c++) {
+    if (nd->sub[c]) burstFreeNode(nd->sub[c]);
+    if (nd->bucket[c]) burstFreeBucket(nd->bucket[c]);
+}
+memDeleteArray(MEM_SORT, nd->ends.items, nd->ends.cap);
+memDeleteArray(MEM_SORT, nd, 1);
+}
+
+/* place e in the node at depth (which splits on name[depth]) */
+void burstInsert(BurstNode* nd, int depth, const BurstEntry& e) {
+for (;;) {
+    char ch = e.name[depth];
+    if (!ch) { burstAppend(nd->ends, e); return; }
+    int c = chIndex(ch);
+    if (nd->sub[c]) { nd = nd->sub[c]; depth++; continue; }
+    BurstBucket* b = nd->bucket[c];
+    if (!b) {
+        b = memNewArray<BurstBucket>(MEM_SORT, 1);
+        b->items = nullptr;
+        b->n = b->cap = 0;
+        nd->bucket[c] = b;
+    }
+    burstAppend(*b, e);
+    if (b->n <= BURST_LIMIT) return;
+    // burst: redistribute one character deeper, keeping export order
+    BurstNode* child = burstNewNode();
+    nd->sub[c] = child;
+    nd->bucket[c] = nullptr;
+    for (int i=0;i<b->n;i++) burstInsert(child, depth+1, b->items[i]);
+    burstFreeBucket(b);
+    return;
+}
+}
+
+inline bool burstLess(const BurstEntry& a, const BurstEntry& b) {
+int d = cmpNames(a.name, b.name);
+return d < 0 || (d == 0 && a.pos < b.pos);
+}
+
+inline void burstSwap(BurstEntry* a, int i, int j) {
+BurstEntry t = a[i]; a[i] = a[j]; a[j] = t;
+}
+
+/* equal names: restore export order */
+void burstSortByPos(BurstEntry* a, int n) {
+while (n > 16) {
+    unsigned p = a[n/2].pos;
+    int i = 0, j = n-1;
+    while (i <= j) {
+        while (a[i].pos < p) i++;
+        while (a[j].pos > p) j--;
+        if (i <= j) burstSwap(a, i++, j--);
+    }
+    if (j+1 < n-i) { burstSortByPos(a, j+1); a += i; n -= i; }
+    else { burstSortByPos(a+i, n-i); n = j+1; }
+}
+for (int i=1;i<n;i++)
+    for (int j=i; j>0 && a[j].pos < a[j-1].pos; j--) burstSwap(a, j, j-1);
+}
+
+/* multikey quicksort on the cached 8-code keys; keys are valid at depth */
+void burstMkqs(BurstEntry* a, int n, int depth) {
+while (n > 1) {
+    if (n <= 16) {
+        for (int i=1;i<n;i++)
+            for (int j=i; j>0 && burstLess(a[j], a[j-1]); j--) burstSwap(a, j, j-1);
+        return;
+    }
+    // median of three keys as pivot
+    unsigned long long x = a[0].key, y = a[n/2].key, z = a[n-1].key;
+    unsigned long long pv = x < y ? (y < z ? y : (x < z ? z : x)) : (x < z ? x : (y < z ? z : y));
+    int lt = 0, i = 0, gt = n-1;
+    while (i <= gt) {
+        if (a[i].key < pv) burstSwap(a, lt++, i++);
+        else if (a[i].key > pv) burstSwap(a, i, gt--);
+        else i++;
+    }
+    burstMkqs(a, lt, depth);
+    burstMkqs(a+gt+1, n-gt-1, depth);
+    // equal block: either every name ended inside these 8 codes, or refill
+    a += lt;
+    n = gt - lt + 1;
+    if ((pv & 0xff) == 0) { burstSortByPos(a, n); return; }
+    depth += 8;
+    for (int k=0;k<n;k++) a[k].key = nameKey8(a[k].name, depth);
+}
+}
+
+/* emit the sorted contents of nd into out[idx..] */
+void burstCollect(BurstNode* nd, int depth, Student** out, int& idx) {
+for (int i=0;i<nd->ends.n;i++) out[idx++] = nd->ends.items[i].student;
+for (int c=0;c<TRIE_ALPHABET;c++) {
+    if (nd->sub[c]) burstCollect(nd->sub[c], depth+1, out, idx);
+    else if (BurstBucket* b = nd->bucket[c]) {
+        for (int i=0;i<b->n;i++) b->items[i].key = nameKey8(b->items[i].name, depth+1);
+        burstMkqs(b->items, b->n, depth+1);
+        for (int i=0;i<b->n;i++) out[idx++] = b->items[i].student;
+    }
+}
+}
+
+/* sort arr[0..n) by name into out (same order as the trie engine) */
+void burstSortNames(Student* const* arr, int n, Student** out) {
+BurstNode* root = burstNewNode();
+for (int i=0;i<n;i++) {
+    BurstEntry e;
+    e.key = 0;
+    e.student = arr[i];
+    e.name = arr[i]->getName();
+    e.pos = (unsigned)i;
+    burstInsert(root, 0, e);
+}
+int idx = 0;
+burstCollect(root, 0, out, idx);
+burstFreeNode(root);
+}
+
+/* -------------------------
+Multikey quicksort by name
+Three-way radix quicksort over a Student* array, in place, in chIndex
+collation. keys[i] caches the next 8 collated codes of arr[i]'s name and is
+swapped along with it, so partitioning compares integers and only refills
+keys (one name read each) when a group of equal 8-code prefixes goes 8
+codes deeper. Apart from the key cache the sort recurses only into the two
+smaller of its three partitions, so the stack stays O(log n).
+Not stable: equal names end up in arbitrary order.
+------------------------- */
+
+inline void mkqsSwap(Student** arr, unsigned long long* keys, int i, int j) {
+Student* s = arr[i]; arr[i] = arr[j]; arr[j] = s;
+unsigned long long k = keys[i]; keys[i] = keys[j]; keys[j] = k;
+}
+
+void mkqsRun(Student** arr, unsigned long long* keys, int n, int depth) {
+while (n > 1) {
+    if (n <= 16) {
+        for (int i=1;i<n;i++) {
+            for (int j=i; j>0; j--) {
+                bool less = keys[j] < keys[j-1]
+                    || (keys[j] == keys[j-1] && (keys[j] & 0xff)
+                        && cmpNames(arr[j]->getName(), arr[j-1]->getName()) < 0);
+                if (!less) break;
+                mkqsSwap(arr, keys, j, j-1);
+            }
+        }
+        return;
+    }
+    unsigned long long x = keys[0], y = keys[n/2], z = keys[n-1];
+    unsigned long long pv = x < y ? (y < z ? y : (x < z ? z : x)) : (x < z ? x : (y < z ? z : y));
+    int lt = 0, i = 0, gt = n-1;
+    while (i <= gt) {
+        if (keys[i] < pv) mkqsSwap(arr, keys, lt++, i++);
+        else if (keys[i] > pv) mkqsSwap(arr, keys, i, gt--);
+        else i++;
+    }
+    int nlo = lt, neq = gt - lt + 1, nhi = n - gt - 1;
+    bool eqDone = (pv & 0xff) == 0; // every name in the block ended: all equal
+    if (!eqDone) {
+        for (int k=lt;k<=gt;k++) keys[k] = nameKey8(arr[k]->getName(), depth + 8);
+    } else {
+        neq = 0;
+    }
+    // recurse into the two smaller partitions, keep looping on the largest
+    if (neq >= nlo && neq >= nhi) {
+        mkqsRun(arr, keys, nlo, depth);
+        mkqsRun(arr + gt + 1, keys + gt + 1, nhi, depth);
+        arr += lt; keys += lt; n = neq; depth += 8;
+    } else if (nlo >= nhi) {
+        if (neq) mkqsRun(arr + lt, keys + lt, neq, depth + 8);
+        mkqsRun(arr + gt + 1, keys + gt + 1, nhi, depth);
+        n = nlo;
+    } else {
+        mkqsRun(arr, keys, nlo, depth);
+        if (neq) mkqsRun(arr + lt, keys + lt, neq, depth + 8);
+        arr += gt + 1; keys += gt + 1; n = nhi;
+    }
+}
+}
+
+/* sort arr[0..n) by name in place (e.g. the output of exportArray()) */
+void multikeySortByName(Student** arr, int n) {
+if (n < 2) return;
+unsigned long long* keys = memNewArray<unsigned long long>(MEM_SORT, n);
+for (int i=0;i<n;i++) keys[i] = nameKey8(arr[i]->getName(), 0);
+mkqsRun(arr, keys, n, 0);
+memDeleteArray(MEM_SORT, keys, n);
+}
+
+/* -------------------------
+Collation-key sort by name
+Stable MSD radix sort on the precomputed collation keys: one byte per pass,
+names whose key ends at the current depth first, small buckets finished by
+insertion sort. Handles UTF-8 names; for ASCII names the result is the same
+as the trie's (equal names keep input order).
+------------------------- */
+
+const int COLL_RADIX_CUTOFF = 32;
+
+void collationRadix(Student** arr, Student** tmp, int n, int depth) {
+if (n <= COLL_RADIX_CUTOFF) {
+    for (int i=1;i<n;i++) {
+        Student* s = arr[i];
+        int j = i-1;
+        while (j >= 0 && cmpCollation(arr[j], s) > 0) { arr[j+1] = arr[j]; j--; }
+        arr[j+1] = s;
+    }
+    return;
+}
+int start[258]; // bucket 0: key ended, bucket b+1: byte b
+memset(start, 0, sizeof(start));
+for (int i=0;i<n;i++) {
+    int kl = arr[i]->collationKeyLen();
+    start[(depth < kl ? arr[i]->collationKey()[depth] + 1 : 0) + 1]++;
+}
+for (int b=0;b<257;b++) start[b+1] += start[b];
+int fill[257];
+memcpy(fill, start, sizeof(fill));
+for (int i=0;i<n;i++) {
+    int kl = arr[i]->collationKeyLen();
+    tmp[fill[depth < kl ? arr[i]->collationKey()[depth] + 1 : 0]++] = arr[i];
+}
+memcpy(arr, tmp, (size_t)n * sizeof(Student*));
+for (int b=1;b<257;b++) {
+    int cnt = start[b+1] - start[b];
+    if (cnt > 1) collationRadix(arr + start[b], tmp, cnt, depth + 1);
+}
+}
+
+/* sort arr[0..n) by name collation key, in place */
+void collationSortByName(Student** arr, int n) {
+if (n < 2) return;
+Student** tmp = memNewArray<Student*>(MEM_SORT, n);
+collationRadix(arr, tmp, n, 0);
+memDeleteArray(MEM_SORT, tmp, n);
+}
+
+/* -------------------------
+Utility to sort by name using trie
+NAME_SORT_TRIE_PARALLEL builds the trie on worker threads; same order.
+NAME_SORT_BURST selects the burstsort engine, which gives the same order.
+NAME_SORT_MULTIKEY sorts the export array in place; same collation, but
+equal names are not kept in export order. These four collate raw bytes;
+NAME_SORT_COLLATION sorts on the UTF-8 collation keys (same order for ASCII).
+------------------------- */
+
+/* out[0..n) = arr[0..n) in trie order */
+void trieSortNames(Student** arr, int n, Student** out) {
+NameTrie trie(n);
+for (int i=0;i<n;i++) trie.insert(arr[i]);
+trie.collectSorted(out, n);
+}
+
+/* Parallel build: partition by the first character (chIndex) into
+   independent subtries, build them on worker threads, and write each
+   bucket's traversal straight into its slice of the output. Buckets are
+   filled in export order and laid out in trie order, so the result is
+   identical to trieSortNames(). threads <= 0 uses every core. */
+const int PARALLEL_TRIE_MIN = 2048; // below this the serial build wins
+const int NAME_BUCKETS = TRIE_ALPHABET + 1; // bucket 0: empty names (trie root)
+
+void parallelTrieSortNames(Student** arr, int n, Student** out, int threads) {
+if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+if (threads <= 1 || n < PARALLEL_TRIE_MIN) { trieSortNames(arr, n, out); return; }
+if (threads > NAME_BUCKETS) threads = NAME_BUCKETS;
+
+// stable counting partition by first character
+int start[NAME_BUCKETS+1];
+for (int b=0;b<=NAME_BUCKETS;b++) start[b] = 0;
+for (int i=0;i<n;i++) {
+    const char* nm = arr[i]->getName();
+    start[(nm[0] ? chIndex(nm[0]) + 1 : 0) + 1]++;
+}
+for (int b=0;b<NAME_BUCKETS;b++) start[b+1] += start[b];
+Student** parts = memNewArray<Student*>(MEM_SORT, n);
+int fill[NAME_BUCKETS];
+for (int b=0;b<NAME_BUCKETS;b++) fill[b] = start[b];
+for (int i=0;i<n;i++) {
+    const char* nm = arr[i]->getName();
+    parts[fill[nm[0] ? chIndex(nm[0]) + 1 : 0]++] = arr[i];
+}
+
+std::atomic<int> nextBucket(0);
+auto worker = [&]() {
+    for (int b = nextBucket.fetch_add(1); b < NAME_BUCKETS; b = nextBucket.fetch_add(1)) {
+        int cnt = start[b+1] - start[b];
+        if (cnt) trieSortNames(parts + start[b], cnt, out + start[b]);
+    }
+};
+// If a thread cannot be started, carry on with the ones that were: they and
+// the calling thread share whatever buckets are left.
+std::thread* pool = nullptr;
+int started = 0;
+try {
+    pool = new std::thread[threads-1];
+    for (; started<threads-1; started++) pool[started] = std::thread(worker);
+} catch (...) {}
+worker(); // the calling thread works too
+for (int t=0;t<started;t++) pool[t].join();
+delete [] pool;
+memDeleteArray(MEM_SORT, parts, n);
+}
+
+enum NameSortEngine { NAME_SORT_TRIE, NAME_SORT_TRIE_PARALLEL, NAME_SORT_BURST, NAME_SORT_MULTIKEY, NAME_SORT_COLLATION };
+
+Student** sortByNameUsingTrie(Course& c, NameSortEngine engine=NAME_SORT_TRIE, int threads=0) {
+int n = c.size();
+if (n==0) return nullptr;
+Student** arr = c.exportArray();
+if (engine == NAME_SORT_MULTIKEY || engine == NAME_SORT_COLLATION) {
+    if (engine == NAME_SORT_MULTIKEY) multikeySortByName(arr, n);
+    else collationSortByName(arr, n);
+    return arr;
+}
+Student** out = memNewArray<Student*>(MEM_EXPORT, n);
+for (int i=0;i<n;i++) out[i]=nullptr;
+if (engine == NAME_SORT_BURST) burstSortNames(arr, n, out);
+else if (engine == NAME_SORT_TRIE_PARALLEL) parallelTrieSortNames(arr, n, out, threads);
+else trieSortNames(arr, n, out);
+releaseStudentArray(arr, n);
+return out;
+}
+
+/* -------------------------
+Composite (multi-key) sort
+ORDER BY e.g. branch, level, total DESC, name: every student gets one
+normalised binary key, built once, whose memcmp order is the requested
+order. The keys are then sorted with a stable LSD radix sort, skipping byte
+positions that are constant across the roster.
+
+* branch, level: one byte
+* marks/total: 8-byte order-preserving encoding of the double
+* roll: ROLL_MAX bytes, zero padded
+* name: COMPOSITE_NAME_PREFIX bytes of the collation key, zero padded (so a
+  shorter name sorts first); rows that tie up to the end of the first name
+  field are re-sorted on full names (cmpCollation) and the later terms
+* descending terms store every byte inverted
+------------------------- */
+
+enum CompositeField { CF_BRANCH=0, CF_LEVEL, CF_ROLL, CF_NAME, CF_ASSIGN, CF_MID, CF_LAB, CF_FINAL, CF_TOTAL };
+
+struct SortTerm {
+CompositeField field;
+bool descending;
+};
+
+const int COMPOSITE_NAME_PREFIX = 16;
+const int COMPOSITE_KEY_MAX = 128;
+
+int compositeFieldWidth(CompositeField f) {
+switch(f) {
+case CF_BRANCH: case CF_LEVEL: return 1;
+case CF_ROLL: return ROLL_MAX;
+case CF_NAME: return COMPOSITE_NAME_PREFIX;
+default: return 8;
+}
+}
+
+/* doubles as big-endian bytes that compare like the values (-0 < +0, no NaN ordering) */
+void encodeDoubleKey(double d, unsigned char* out) {
+unsigned long long bits;
+memcpy(&bits, &d, sizeof(bits));
+bits = (bits >> 63) ? ~bits : (bits | 0x8000000000000000ULL);
+for (int i=7;i>=0;i--) { out[i] = (unsigned char)(bits & 0xff); bits >>= 8; }
+}
+
+/* write the key for s into out; returns its length */
+int buildCompositeKey(const Student* s, const SortTerm* terms, int nterms, unsigned char* out) {
+int len = 0;
+for (int t=0;t<nterms;t++) {
+    unsigned char* p = out + len;
+    int w = compositeFieldWidth(terms[t].field);
+    switch(terms[t].field) {
+    case CF_BRANCH: p[0] = (unsigned char)s->getBranch(); break;
+    case CF_LEVEL: p[0] = (unsigned char)s->getLevel(); break;
+    case CF_ROLL: {
+        const char* r = s->getRoll();
+        int i = 0;
+        for (; i<w && r[i]; i++) p[i] = (unsigned char)r[i];
+        for (; i<w; i++) p[i] = 0;
+        break;
+    }
+    case CF_NAME: {
+        const unsigned char* ck = s->collationKey();
+        int kl = s->collationKeyLen();
+        int i = 0;
+        for (; i<w && i<kl; i++) p[i] = ck[i];
+        for (; i<w; i++) p[i] = 0;
+        break;
+    }
+    case CF_TOTAL: encodeDoubleKey(s->totalMarks(), p); break;
+    default: encodeDoubleKey(s->getMarks().at((MarkComponent)(terms[t].field - CF_ASSIGN)), p); break;
+    }
+    if (terms[t].descending) for (int i=0;i<w;i++) p[i] = (unsigned char)~p[i];
+    len += w;
+}
+return len;
+}
+
+/* full comparison of rows a and b: key bytes term by term, with names that
+   tie on their prefix finished on the whole collation key */
+struct CompositeOrder {
+const unsigned char* keys;
+int L;
+Student** arr;
+const SortTerm* terms;
+int nterms;
+int operator()(int a, int b) const {
+    const unsigned char* ka = keys + (size_t)a*L;
+    const unsigned char* kb = keys + (size_t)b*L;
+    int off = 0;
+    for (int t=0;t<nterms;t++) {
+        int w = compositeFieldWidth(terms[t].field);
+        int c = memcmp(ka+off, kb+off, w);
+        if (c) return c;
+        if (terms[t].field == CF_NAME) {
+            c = cmpCollation(arr[a], arr[b]);
+            if (c) return terms[t].descending ? -c : c;
+        }
+        off += w;
+    }
+    return 0;
+}
+};
+
+/* stable merge sort of rows idx[lo..hi); tmp has room for hi-lo entries */
+void mergeSortComposite(int* idx, int* tmp, int lo, int hi, const CompositeOrder& cmp) {
+if (hi - lo <= MERGE_INSERTION_CUTOFF) {
+    for (int i=lo+1;i<hi;i++) {
+        int r = idx[i];
+        int j = i-1;
+        while (j >= lo && cmp(idx[j], r) > 0) { idx[j+1] = idx[j]; j--; }
+        idx[j+1] = r;
+    }
+    return;
+}
+int mid = lo + (hi-lo)/2;
+mergeSortComposite(idx, tmp, lo, mid, cmp);
+mergeSortComposite(idx, tmp, mid, hi, cmp);
+if (cmp(idx[mid-1], idx[mid]) <= 0) return;
+int i = lo, j = mid, o = 0;
+while (i < mid && j < hi) {
+    if (cmp(idx[j], idx[i]) < 0) tmp[o++] = idx[j++]; else tmp[o++] = idx[i++];
+}
+while (i < mid) tmp[o++] = idx[i++];
+while (j < hi) tmp[o++] = idx[j++];
+memcpy(idx+lo, tmp, o*sizeof(int));
+}
+
+/* Sort arr[0..n) in place by terms. Stable: students with equal keys keep
+   their input order, so the output is deterministic for a given input. */
+void sortComposite(Student** arr, int n, const SortTerm* terms, int nterms) {
+if (n < 2 || nterms <= 0) return;
+int L = 0;
+int nameTerm = -1;
+for (int t=0;t<nterms;t++) {
+    if (terms[t].field == CF_NAME && nameTerm < 0) nameTerm = t;
+    L += compositeFieldWidth(terms[t].field);
+}
+if (L > COMPOSITE_KEY_MAX) throw BufferOverflowException();
+
+unsigned char* keys = memNewArray<unsigned char>(MEM_SORT, (size_t)n * L);
+for (int i=0;i<n;i++) buildCompositeKey(arr[i], terms, nterms, keys + (size_t)i*L);
+int* idx = memNewArray<int>(MEM_SORT, n);
+int* tmp = memNewArray<int>(MEM_SORT, n);
+for (int i=0;i<n;i++) idx[i] = i;
+
+int counts[256];
+for (int pos=L-1; pos>=0; pos--) {
+    memset(counts, 0, sizeof(counts));
+    for (int i=0;i<n;i++) counts[keys[(size_t)i*L + pos]]++;
+    if (counts[keys[pos]] == n) continue; // constant byte: nothing to do
+    int sum = 0;
+    for (int b=0;b<256;b++) { int c = counts[b]; counts[b] = sum; sum += c; }
+    for (int i=0;i<n;i++) tmp[counts[keys[(size_t)idx[i]*L + pos]]++] = idx[i];
+    int* sw = idx; idx = tmp; tmp = sw;
+}
+
+// The radix pass only saw the first COMPOSITE_NAME_PREFIX bytes of each name,
+// so rows that tie up to the end of the first name field may be misordered by
+// later terms. Re-sort each such run with the full comparison.
+if (nameTerm >= 0) {
+    int nameEnd = COMPOSITE_NAME_PREFIX;
+    for (int t=0;t<nameTerm;t++) nameEnd += compositeFieldWidth(terms[t].field);
+    CompositeOrder cmp = { keys, L, arr, terms, nterms };
+    int i = 0;
+    while (i < n) {
+        int j = i+1;
+        bool longName = false;
+        while (j < n && memcmp(keys + (size_t)idx[i]*L, keys + (size_t)idx[j]*L, nameEnd) == 0) j++;
+        // names that fit the prefix were already compared exactly
+        for (int a=i;j-i>1 && a<j && !longName;a++)
+            longName = arr[idx[a]]->collationKeyLen() > COMPOSITE_NAME_PREFIX;
+        if (longName) mergeSortComposite(idx, tmp, i, j, cmp);
+        i = j;
+    }
+}
+
+Student** out = memNewArray<Student*>(MEM_SORT, n);
+for (int i=0;i<n;i++) out[i] = arr[idx[i]];
+
+memcpy(arr, out, (size_t)n * sizeof(Student*));
+memDeleteArray(MEM_SORT, out, n);
+memDeleteArray(MEM_SORT, keys, (size_t)n * L);
+memDeleteArray(MEM_SORT, idx, n);
+memDeleteArray(MEM_SORT, tmp, n);
+}
+
+/* -------------------------
+Record files and external merge sort
+Archives are flat files of fixed-size StudentRecords. ExternalSorter sorts a
+file larger than memory: it reads runs that fit the memory budget, sorts each
+run with the stable sortStudents(), spills it to a temporary file and
+k-way merges runs with a loser tree. Runs are merged while they are being
+spilled, as soon as fanIn runs of the same merge depth are open, so at most
+EXTSORT_OPEN_RUNS temporary files are open however large the input is.
+Equal keys keep file order.
+------------------------- */
+
+class FileIOException : public StudentException {
+public:
+FileIOException() : StudentException("Error reading or writing record file") {}
+};
+
+const int RECORD_BLOCK = 256; // records per buffered read/write
+
+/* buffered sequential reader */
+class RecordReader {
+private:
+FILE* f;
+bool owns;
+StudentRecord* buf;
+int len, pos;
+RecordReader(const RecordReader&) = delete;
+RecordReader& operator=(const RecordReader&) = delete;
+public:
+RecordReader(const char* path): owns(true), len(0), pos(0) {
+    f = fopen(path, "rb");
+    if (!f) throw FileIOException();
+    buf = memNewArray<StudentRecord>(MEM_RECORDS, RECORD_BLOCK);
+}
+// read an already open file from its start (not closed by the reader)
+RecordReader(FILE* file): f(file), owns(false), len(0), pos(0) {
+    rewind(f);
+    buf = memNewArray<StudentRecord>(MEM_RECORDS, RECORD_BLOCK);
+}
+~RecordReader() {
+    if (owns) fclose(f);
+    memDeleteArray(MEM_RECORDS, buf, RECORD_BLOCK);
+}
+bool next(StudentRecord& r) {
+    if (pos == len) {
+        len = (int)fread(buf, sizeof(StudentRecord), RECORD_BLOCK, f);
+        pos = 0;
+        if (len == 0) {
+            if (ferror(f)) throw FileIOException();
+            return false;
+        }
+    }
+    r = buf[pos++];
+    return true;
+}
+};
+
+/* buffered sequential writer */
+class RecordWriter {
+private:
+FILE* f;
+bool owns;
+StudentRecord* buf;
+int len;
+RecordWriter(const RecordWriter&) = delete;
+RecordWriter& operator=(const RecordWriter&) = delete;
+public:
+RecordWriter(const char* path): owns(true), len(0) {
+    f = fopen(path, "wb");
+    if (!f) throw FileIOException();
+    buf = memNewArray<StudentRecord>(MEM_RECORDS, RECORD_BLOCK);
+}
+RecordWriter(FILE* file): f(file), owns(false), len(0) {
+    buf = memNewArray<StudentRecord>(MEM_RECORDS, RECORD_BLOCK);
+}
+~RecordWriter() {
+    try { flush(); } catch (StudentException&) {}
+    if (owns) fclose(f);
+    memDeleteArray(MEM_RECORDS, buf, RECORD_BLOCK);
+}
+void write(const StudentRecord& r) {
+    if (len == RECORD_BLOCK) flush();
+    buf[len++] = r;
+}
+void flush() {
+    if (len && fwrite(buf, sizeof(StudentRecord), len, f) != (size_t)len) throw FileIOException();
+    len = 0;
+    if (fflush(f) != 0) throw FileIOException();
+}
+};
+
+/* write every student of the course to path; returns the record count */
+long long exportRecords(Course& c, const char* path) {
+RecordWriter w(path);
+Student** arr = c.exportArray();
+StudentRecord r;
+for (int i=0;i<c.size();i++) {
+    toRecord(arr[i], r);
+    w.write(r);
+}
+releaseStudentArray(arr, c.size());
+w.flush();
+return c.size();
+}
+
+const int EXTSORT_OPEN_RUNS = 32; // spilled runs open at once (file descriptors)
+
+class ExternalSorter {
+private:
+size_t budget;
+SortKey key;
+
+// one input run during a merge
+struct RunSource {
+RecordReader* reader;
+ArchivedStudent cur;
+bool done;
+};
+
+// temporary file, closed on scope exit unless released
+class TempFile {
+private:
+FILE* f;
+TempFile(const TempFile&) = delete;
+TempFile& operator=(const TempFile&) = delete;
+public:
+TempFile(): f(tmpfile()) { if (!f) throw FileIOException(); }
+~TempFile() { if (f) fclose(f); }
+FILE* get() const { return f; }
+FILE* release() { FILE* t = f; f = nullptr; return t; }
+};
+
+// open runs in input order with their merge depth; closes whatever it holds
+class RunStack {
+private:
+FILE* files[EXTSORT_OPEN_RUNS];
+int depths[EXTSORT_OPEN_RUNS];
+int n;
+RunStack(const RunStack&) = delete;
+RunStack& operator=(const RunStack&) = delete;
+public:
+RunStack(): n(0) {}
+~RunStack() { while (n) fclose(files[--n]); }
+int size() const { return n; }
+int depth(int i) const { return depths[i]; }
+FILE** top(int k) { return files + n - k; }
+void push(FILE* f, int d) { files[n] = f; depths[n] = d; n++; }
+void pop(int k) { while (k-- > 0) fclose(files[--n]); }
+};
+
+// loser-tree state of one merge; frees readers and arrays on every exit path
+struct MergeState {
+int k;
+RunSource* src;
+int* tree;  // tree[0] = winner, tree[1..k) = losers
+int* win;
+MergeState(const MergeState&) = delete;
+MergeState& operator=(const MergeState&) = delete;
+MergeState(): k(0), src(nullptr), tree(nullptr), win(nullptr) {}
+void open(FILE** runs, int n) {
+    k = n;
+    tree = memNewArray<int>(MEM_SORT, n);
+    win = memNewArray<int>(MEM_SORT, 2*n);
+    src = memNewArray<RunSource>(MEM_SORT, n);
+    for (int i=0;i<k;i++) src[i].reader = nullptr;
+    for (int i=0;i<k;i++) src[i].reader = new RecordReader(runs[i]);
+}
+~MergeState() {
+    if (src) for (int i=0;i<k;i++) delete src[i].reader;
+    memDeleteArray(MEM_SORT, src, k);
+    memDeleteArray(MEM_SORT, tree, k);
+    memDeleteArray(MEM_SORT, win, 2*k);
+}
+};
+
+static bool less(RunSource* src, int a, int b, SortKey k) {
+    if (src[a].done) return false;
+    if (src[b].done) return true;
+    int c = compareKey(&src[a].cur, &src[b].cur, k);
+    return c < 0 || (c == 0 && a < b); // earlier run wins ties: stable
+}
+
+static void advance(RunSource& s) {
+    StudentRecord r;
+    if (s.reader->next(r)) s.cur.load(r); else s.done = true;
+}
+
+// merge runs[0..k) into out with a loser tree
+void mergeRuns(FILE** runs, int k, RecordWriter& out) {
+    MergeState st;
+    st.open(runs, k);
+    RunSource* src = st.src;
+    int* tree = st.tree;
+    int* win = st.win;
+    for (int i=0;i<k;i++) {
+        src[i].done = false;
+        advance(src[i]);
+        win[k+i] = i;
+    }
+    for (int nd=k-1; nd>=1; nd--) {
+        int a = win[2*nd], b = win[2*nd+1];
+        if (less(src, a, b, key)) { win[nd] = a; tree[nd] = b; }
+        else { win[nd] = b; tree[nd] = a; }
+    }
+    tree[0] = (k == 1) ? 0 : win[1];
+    StudentRecord r;
+    while (!src[tree[0]].done) {
+        int w = tree[0];
+        toRecord(&src[w].cur, r);
+        out.write(r);
+        advance(src[w]);
+        // replay the path from leaf w to the root
+        for (int nd=(w+k)/2; nd>=1; nd/=2) {
+            if (less(src, tree[nd], w, key)) { int t = tree[nd]; tree[nd] = w; w = t; }
+        }
+        tree[0] = w;
+    }
+}
+
+// replace the top k runs by their merge (adjacent runs, so order stays stable)
+void mergeTop(RunStack& runs, int k) {
+    TempFile merged;
+    {
+        RecordWriter w(merged.get());
+        mergeRuns(runs.top(k), k, w);
+        w.flush();
+    }
+    int d = 0;
+    for (int i=runs.size()-k; i<runs.size(); i++) if (runs.depth(i) > d) d = runs.depth(i);
+    runs.pop(k);
+    runs.push(merged.release(), d+1);
+}
+
+// merge while fanIn runs of one depth sit on top, or while more than limit are open
+void collapse(RunStack& runs, int fanIn, int limit) {
+    while (runs.size() > 1) {
+        int n = runs.size(), d = runs.depth(n-1), same = 1;
+        while (same < n && runs.depth(n-1-same) == d) same++;
+        if (same >= fanIn) mergeTop(runs, fanIn);
+        else if (n > limit) mergeTop(runs, n < fanIn ? n : fanIn);
+        else break;
+    }
+}
+
+public:
+// memoryBudget bounds run buffers and merge buffers (in bytes)
+ExternalSorter(size_t memoryBudget, SortKey k): budget(memoryBudget), key(k) {}
+
+// sort the records of inPath into outPath; returns the record count
+long long sort(const char* inPath, const char* outPath) {
+    // each merge input needs a read block plus one decoded record; one block for the output.
+    // At most half the open-run cap so merges by depth happen before the cap forces them.
+    size_t perSource = RECORD_BLOCK*sizeof(StudentRecord) + sizeof(RunSource);
+    int fanIn = (int)(budget / perSource) - 1;
+    if (fanIn < 2) fanIn = 2;
+    if (fanIn > EXTSORT_OPEN_RUNS/2) fanIn = EXTSORT_OPEN_RUNS/2;
+
+    // sorted runs are spilled to temporary files and merged as they accumulate
+    size_t perRecord = sizeof(ArchivedStudent) + 2*sizeof(Student*); // object + array + merge scratch
+    int runCap = (int)(budget / perRecord);
+    if (runCap < 2) runCap = 2;
+    RunStack runs;
+    long long total = 0;
+    ArchivedStudent* pool = memNewArray<ArchivedStudent>(MEM_SORT, runCap);
+    Student** arr = nullptr;
+    try {
+        arr = memNewArray<Student*>(MEM_SORT, runCap);
+        SortScratch scratch;
+        RecordReader in(inPath);
+        StudentRecord r;
+        bool more = true;
+        while (more) {
+            int n = 0;
+            while (n < runCap && (more = in.next(r))) {
+                pool[n].load(r);
+                arr[n] = &pool[n];
+                n++;
+            }
+            if (n == 0) break;
+            total += n;
+            sortStudents(arr, n, key, SORT_STABLE, &scratch);
+            TempFile f;
+            {
+                RecordWriter w(f.get());
+                for (int i=0;i<n;i++) { toRecord(arr[i], r); w.write(r); }
+                w.flush();
+            }
+            runs.push(f.release(), 0);
+            collapse(runs, fanIn, EXTSORT_OPEN_RUNS-1); // room for the next run
+        }
+    } catch (...) {
+        memDeleteArray(MEM_SORT, pool, runCap);
+        memDeleteArray(MEM_SORT, arr, runCap);
+        throw;
+    }
+    memDeleteArray(MEM_SORT, pool, runCap);
+    memDeleteArray(MEM_SORT, arr, runCap);
+
+    // final merge of at most fanIn runs into the output
+    collapse(runs, fanIn, fanIn);
+    RecordWriter out(outPath);
+    if (runs.size() > 0) mergeRuns(runs.top(runs.size()), runs.size(), out);
+    out.flush();
+    return total;
+}
+
+};
+
+/* -------------------------
+Quantile sketches (KLL)
+Approximate quantiles of marks over archives too large to hold in memory.
+A KllSketch keeps a stack of compactors: level h holds items of weight 2^h
+and has capacity about k * (2/3)^(levels-1-h) (at least KLL_MIN_WIDTH).
+A full level is sorted and every other item, from a random offset, moves up
+with doubled weight. Memory is O(k log(n/k)) whatever n is, and two sketches
+merge by concatenating levels and compacting again, so per-shard and
+per-branch sketches combine cheaply and the result is as accurate as one
+sketch built from the union.
+
+Error bound (the published empirical fit for KLL with these capacities),
+at 99% confidence: one quantile() or rank() answer is within eps * n of
+exact for eps = 2.296 / k^0.9723, i.e. 1.33% at the default k = 200 and
+0.68% at k = 400; all ranks at once (a whole CDF) are within
+2.446 / k^0.9433, i.e. 1.65% and 0.86%. The bound needs independent coin
+flips in every merged sketch, so each sketch draws its own seed. Min and
+max are exact.
+------------------------- */
+
+const int KLL_DEFAULT_K = 200;
+const int KLL_MIN_WIDTH = 8;
+const int KLL_MAX_LEVELS = 48;
+
+/* fresh seed per sketch: a process-wide counter plus the clock, mixed with
+   splitmix64 */
+unsigned long long kllSeed() {
+static std::atomic<unsigned long long> counter(0);
+unsigned long long z = (counter.fetch_add(1) + 1) * 0x9E3779B97F4A7C15ULL
+    + (unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count();
+z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+z ^= z >> 31;
+return z ? z : 1;
+}
+
+/* quicksort of a[0..n) by less(x, y) */
+template<class T, class Less> void quickSortBy(T* a, int n, Less less) {
+while (n > 16) {
+    T pv = a[n/2];
+    int i = 0, j = n-1;
+    while (i <= j) {
+        while (less(a[i], pv)) i++;
+        while (less(pv, a[j])) j--;
+        if (i <= j) { T t = a[i]; a[i] = a[j]; a[j] = t; i++; j--; }
+    }
+    // recurse into the smaller side
+    if (j+1 < n-i) { quickSortBy(a, j+1, less); a += i; n -= i; }
+    else { quickSortBy(a+i, n-i, less); n = j+1; }
+}
+for (int i=1;i<n;i++) {
+    T t = a[i];
+    int j = i-1;
+    while (j >= 0 && less(t, a[j])) { a[j+1] = a[j]; j--; }
+    a[j+1] = t;
+}
+}
+
+class KllSketch {
+private:
+struct Level {
+    double* items;
+    int n;
+    int cap; // allocated
 };
-Node* head;
-int count;
+int k;
+int numLevels;
+Level levels[KLL_MAX_LEVELS];
+long long count;
+double minV, maxV;
+unsigned long long rng;
 
-// disallow copying to respect data hiding ownership
-Course(const Course&) = delete;
-Course& operator=(const Course&) = delete;
+KllSketch(const KllSketch&) = delete;
+KllSketch& operator=(const KllSketch&) = delete;
+
+int capacity(int h) const {
+    double c = k;
+    for (int d = numLevels-1-h; d > 0; d--) c *= 2.0/3.0;
+    int w = (int)ceil(c);
+    return w < KLL_MIN_WIDTH ? KLL_MIN_WIDTH : w;
+}
+
+void push(int h, double v) {
+    Level& lv = levels[h];
+    if (lv.n == lv.cap) {
+        int newcap = lv.cap ? lv.cap*2 : 16;
+        double* tmp = memNewArray<double>(MEM_SKETCH, newcap);
+        if (lv.n) memcpy(tmp, lv.items, lv.n*sizeof(double));
+        memDeleteArray(MEM_SKETCH, lv.items, lv.cap);
+        lv.items = tmp;
+        lv.cap = newcap;
+    }
+    lv.items[lv.n++] = v;
+}
+
+bool randomBit() {
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17; // xorshift64
+    return rng & 1;
+}
+
+// halve level h into h+1; an odd item out stays behind
+void compact(int h) {
+    if (h+1 == numLevels) {
+        if (numLevels == KLL_MAX_LEVELS) return; // beyond 2^47 items per slot
+        numLevels++;
+    }
+    Level& lv = levels[h];
+    quickSortBy(lv.items, lv.n, [](double x, double y) { return x < y; });
+    int start = 0;
+    double keep = 0;
+    bool odd = lv.n & 1;
+    if (odd) { keep = lv.items[0]; start = 1; }
+    for (int i = start + (randomBit() ? 1 : 0); i < lv.n; i += 2) push(h+1, lv.items[i]);
+    lv.n = 0;
+    if (odd) lv.items[lv.n++] = keep;
+}
+
+void compress() {
+    for (int h=0; h<numLevels; h++) {
+        if (levels[h].n >= capacity(h)) compact(h);
+    }
+}
 
 public:
-Course(): head(nullptr), count(0) {}
-~Course() {
-Node* cur = head;
-while (cur) {
-Node* nxt = cur->next;
-delete cur->student;
-delete cur;
-cur = nxt;
+// seed 0 draws a fresh seed; pass a fixed one only for reproducible tests
+explicit KllSketch(int k_ = KLL_DEFAULT_K, unsigned long long seed = 0)
+    : k(k_ < KLL_MIN_WIDTH ? KLL_MIN_WIDTH : k_), numLevels(1), count(0), minV(0), maxV(0),
+      rng(seed ? seed : kllSeed()) {
+    for (int h=0;h<KLL_MAX_LEVELS;h++) { levels[h].items = nullptr; levels[h].n = levels[h].cap = 0; }
 }
+~KllSketch() {
+    for (int h=0;h<KLL_MAX_LEVELS;h++) memDeleteArray(MEM_SKETCH, levels[h].items, levels[h].cap);
 }
 
-// add student (Course takes ownership). Use operator+=
-Course& operator+=(Student* s) {
-    Node* n = new Node(s);
-    // insert at head for simplicity
-    n->next = head;
-    head = n;
+void add(double v) {
+    if (count == 0 || v < minV) minV = v;
+    if (count == 0 || v > maxV) maxV = v;
     count++;
-    return *this;
+    push(0, v);
+    if (levels[0].n >= capacity(0)) compress();
 }
 
-// find student by roll. returns Student*, or nullptr
-Student* findByRoll(const char* roll) {
-    Node* cur = head;
-    while (cur) {
-        if (strcmp(cur->student->getRoll(), roll) == 0) return cur->student;
-        cur = cur->next;
+// fold o into this sketch (o is unchanged); k of this sketch is kept.
+// o may be this sketch: each level's size is read before pushing into it.
+void merge(const KllSketch& o) {
+    if (o.count == 0) return;
+    if (count == 0 || o.minV < minV) minV = o.minV;
+    if (count == 0 || o.maxV > maxV) maxV = o.maxV;
+    count += o.count;
+    while (numLevels < o.numLevels) numLevels++;
+    for (int h=0;h<o.numLevels;h++) {
+        int n = o.levels[h].n;
+        for (int i=0;i<n;i++) push(h, o.levels[h].items[i]);
     }
-    return nullptr;
+    compress();
 }
 
-// operator() to access/modify by roll number. Throws RollNotFoundException if not present.
-Student& operator()(const char* roll) {
-    Student* s = findByRoll(roll);
-    if (!s) throw RollNotFoundException();
-    return *s;
-}
+long long size() const { return count; }
+double min() const { return minV; }
+double max() const { return maxV; }
 
-int size() const { return count; }
+// retained items (memory use is O(this))
+int retained() const {
+    int r = 0;
+    for (int h=0;h<numLevels;h++) r += levels[h].n;
+    return r;
+}
 
-// export to array (array of Student*) for sorting
-Student** exportArray() {
-    if (count == 0) return nullptr;
-    Student** arr = new Student*[count];
-    int idx = 0;
-    Node* cur = head;
-    while (cur) {
-        arr[idx++] = cur->student;
-        cur = cur->next;
+// approximate value at fraction q of the data (0 = min, 0.5 = median, 1 = max)
+double quantile(double q) const {
+    if (count == 0) return 0;
+    if (q <= 0) return minV;
+    if (q >= 1) return maxV;
+    struct Weighted { double v; long long w; };
+    int r = retained();
+    Weighted* all = memNewArray<Weighted>(MEM_SKETCH, r);
+    int m = 0;
+    for (int h=0;h<numLevels;h++)
+        for (int i=0;i<levels[h].n;i++) { all[m].v = levels[h].items[i]; all[m].w = 1LL << h; m++; }
+    quickSortBy(all, m, [](const Weighted& x, const Weighted& y) { return x.v < y.v; });
+    long long total = 0;
+    for (int i=0;i<m;i++) total += all[i].w;
+    double target = q * (double)total;
+    long long cum = 0;
+    double res = all[m-1].v;
+    for (int i=0;i<m;i++) {
+        cum += all[i].w;
+        if ((double)cum >= target) { res = all[i].v; break; }
     }
-    return arr;
+    memDeleteArray(MEM_SKETCH, all, r);
+    return res;
 }
 
-// print all
-void printAll() const {
-    Node* cur = head;
-    while (cur) {
-        cur->student->print();
-        cur = cur->next;
+// approximate fraction of the data <= v
+double rank(double v) const {
+    if (count == 0) return 0;
+    long long below = 0, total = 0;
+    for (int h=0;h<numLevels;h++) {
+        for (int i=0;i<levels[h].n;i++) {
+            total += 1LL << h;
+            if (levels[h].items[i] <= v) below += 1LL << h;
+        }
     }
+    return (double)below / (double)total;
 }
+};
 
-// remove student by roll (optional helper)
-bool removeByRoll(const char* roll) {
-    Node* cur = head;
-    Node* prev = nullptr;
-    while (cur) {
-        if (strcmp(cur->student->getRoll(), roll) == 0) {
-            if (prev) prev->next = cur->next; else head = cur->next;
-            delete cur->student;
-            delete cur;
-            count--;
-            return true;
-        }
-        prev = cur;
-        cur = cur->next;
+/* one sketch per MarkComponent plus the total; merge per shard or branch */
+class MarksSketch {
+private:
+KllSketch comp[MC_COUNT];
+KllSketch tot;
+MarksSketch(const MarksSketch&) = delete;
+MarksSketch& operator=(const MarksSketch&) = delete;
+public:
+MarksSketch() {}
+
+void add(const Marks& m) {
+    for (int c=0;c<MC_COUNT;c++) comp[c].add(m.at((MarkComponent)c));
+    tot.add(m.total());
+}
+
+void merge(const MarksSketch& o) {
+    for (int c=0;c<MC_COUNT;c++) comp[c].merge(o.comp[c]);
+    tot.merge(o.tot);
+}
+
+// stream an archive; branch filters to one branch (HIST_ANY: all).
+// Returns the records added
+long long addRecords(RecordReader& rd, int branch = HIST_ANY) {
+    StudentRecord r;
+    long long added = 0;
+    while (rd.next(r)) {
+        if (branch != HIST_ANY && r.branch != branch) continue;
+        add(r.marks);
+        added++;
     }
-    return false;
+    return added;
+}
+
+// scan a consistent snapshot of a live course
+long long addSnapshot(const SnapshotReader& snap, int branch = HIST_ANY) {
+    long long added = 0;
+    snap.forEach([&](const StudentRecord& r) {
+        if (branch != HIST_ANY && r.branch != branch) return;
+        add(r.marks);
+        added++;
+    });
+    return added;
 }
 
+const KllSketch& component(MarkComponent mc) const { return comp[mc]; }
+const KllSketch& total() const { return tot; }
+double quantile(MarkComponent mc, double q) const { return comp[mc].quantile(q); }
+double totalQuantile(double q) const { return tot.quantile(q); }
+long long size() const { return tot.size(); }
 };
 
 /* -------------------------
-Sorting utilities
+Double-array trie (static name dictionary)
+Read-mostly lookup structure for archived rosters: built once from a
+NameTrie (or directly from a Course), queried with two array accesses per
+character (t = base[s] + code, valid iff check[t] == s), saved as flat arrays
+and mapped back with mmap without rebuilding.
 
-* Sort by roll (lexicographic)
-* Sort by marks component (assignment|midterm|lab|final)
-* Sort by name using Trie
-  No STL: implement quicksort on array of Student*
-  ------------------------- */
+Names use the chIndex collation (code = chIndex + 1). Every terminal state
+owns a run in the postings array holding record ids: positions in the
+course's export order (the order exportRecords() writes an archive in) when
+built from a Course, or positions in sorted order when built from a trie.
 
-int cmpRoll(const char* a, const char* b) {
-return strcmp(a,b);
-}
+File layout: DatHeader, then int32 base[states], int32 check[states],
+uint32 postStart[states], uint32 postCount[states], uint32 postings[n].
+------------------------- */
 
-enum MarkComponent { MC_ASSIGN=0, MC_MID=1, MC_LAB=2, MC_FINAL=3 };
+struct DatHeader {
+char magic[8];        // "STDATRI1"
+unsigned states;
+unsigned postings;
+};
 
-double getComponent(const Student* s, MarkComponent mc) {
-switch(mc) {
-case MC_ASSIGN: return s->getMarks().assignment;
-case MC_MID: return s->getMarks().midterm;
-case MC_LAB: return s->getMarks().lab;
-case MC_FINAL: return s->getMarks().finalexam;
-}
-return 0;
+class DoubleArrayTrie {
+private:
+int* base;
+int* check;
+unsigned* postStart;
+unsigned* postCount;
+unsigned* postings;
+unsigned states;     // allocated length of the per-state arrays
+unsigned used;       // states in use (highest state + 1)
+unsigned npostings;
+unsigned postCap;
+void* mapped;      // non-null when the arrays point into an mmap'd file
+size_t mappedLen;
+
+DoubleArrayTrie(const DoubleArrayTrie&) = delete;
+DoubleArrayTrie& operator=(const DoubleArrayTrie&) = delete;
+
+void release() {
+    if (mapped) {
+        munmap(mapped, mappedLen);
+    } else {
+        memDeleteArray(MEM_INDEX, base, states);
+        memDeleteArray(MEM_INDEX, check, states);
+        memDeleteArray(MEM_INDEX, postStart, states);
+        memDeleteArray(MEM_INDEX, postCount, states);
+        memDeleteArray(MEM_INDEX, postings, postCap);
+    }
+    base = check = nullptr;
+    postStart = postCount = postings = nullptr;
+    states = used = npostings = postCap = 0;
+    mapped = nullptr;
+    mappedLen = 0;
 }
 
-/* quicksort for Student* array using comparator function */
-typedef int (*CmpFn)(Student*, Student*);
+void grow(unsigned need) {
+    if (need <= states) return;
+    unsigned cap = states ? states : 64;
+    while (cap < need) cap *= 2;
+    int* nb = memNewArray<int>(MEM_INDEX, cap);
+    int* nc = memNewArray<int>(MEM_INDEX, cap);
+    unsigned* ns = memNewArray<unsigned>(MEM_INDEX, cap);
+    unsigned* nn = memNewArray<unsigned>(MEM_INDEX, cap);
+    for (unsigned i=0;i<cap;i++) {
+        nb[i] = i < states ? base[i] : DAT_NO_BASE;
+        nc[i] = i < states ? check[i] : -1;
+        ns[i] = i < states ? postStart[i] : 0;
+        nn[i] = i < states ? postCount[i] : 0;
+    }
+    memDeleteArray(MEM_INDEX, base, states);
+    memDeleteArray(MEM_INDEX, check, states);
+    memDeleteArray(MEM_INDEX, postStart, states);
+    memDeleteArray(MEM_INDEX, postCount, states);
+    base = nb; check = nc; postStart = ns; postCount = nn;
+    states = cap;
+}
 
-int cmpByRollPtr(Student* a, Student* b) {
-return strcmp(a->getRoll(), b->getRoll());
+// state reached from s on code, or -1
+int step(int s, int code) const {
+    if (base[s] == DAT_NO_BASE) return -1;
+    long t = (long)base[s] + code;
+    if (t < 0 || t >= (long)used || check[t] != s) return -1;
+    return (int)t;
 }
 
-int cmpByMarksPtrFactory(Student* a, Student* b, MarkComponent mc) {
-double da = getComponent(a, mc);
-double db = getComponent(b, mc);
-if (da < db) return -1;
-if (da > db) return 1;
-return strcmp(a->getRoll(), b->getRoll()); // tie-breaker
+// state reached by the whole (collated) string, or -1
+int walk(const char* key) const {
+    if (!used) return -1;
+    int s = 0;
+    for (; *key && s >= 0; key++) s = step(s, chIndex(*key) + 1);
+    return s;
 }
 
-void quickSwap(Student** arr, int i, int j) {
-Student* t = arr[i]; arr[i]=arr[j]; arr[j]=t;
+template<class Fn> void emitSubtree(int s, Fn& fn) const {
+    // depth-first in code order; depth is bounded by NAME_MAX
+    struct Frame { int state; int code; };
+    Frame stack[NAME_MAX+1];
+    int top = 0;
+    for (unsigned i=0;i<postCount[s];i++) fn(postings[postStart[s]+i]);
+    stack[0].state = s;
+    stack[0].code = 1;
+    while (top >= 0) {
+        Frame& f = stack[top];
+        if (f.code > TRIE_ALPHABET) { top--; continue; }
+        int t = step(f.state, f.code++);
+        if (t < 0) continue;
+        for (unsigned i=0;i<postCount[t];i++) fn(postings[postStart[t]+i]);
+        if (top < NAME_MAX) {
+            top++;
+            stack[top].state = t;
+            stack[top].code = 1;
+        }
+    }
 }
 
-/* quicksort by roll */
-void quickSortRoll(Student** arr, int lo, int hi) {
-if (lo >= hi) return;
-Student* pivot = arr[(lo+hi)/2];
-int i = lo, j = hi;
-while (i <= j) {
-while (strcmp(arr[i]->getRoll(), pivot->getRoll()) < 0) i++;
-while (strcmp(arr[j]->getRoll(), pivot->getRoll()) > 0) j--;
-if (i <= j) {
-quickSwap(arr, i, j);
-i++; j--;
+public:
+static const int DAT_NO_BASE = -0x40000000; // state without children
+
+DoubleArrayTrie(): base(nullptr), check(nullptr), postStart(nullptr), postCount(nullptr),
+    postings(nullptr), states(0), used(0), npostings(0), postCap(0), mapped(nullptr), mappedLen(0) {}
+~DoubleArrayTrie() { release(); }
+
+// Build from a trie. Record ids are positions in order[0..n): pass the
+// export order of the archive the ids should point into.
+void build(const NameTrie& trie, Student* const* order, int n) {
+    release();
+    // address -> id table, sorted by address for binary search
+    struct IdEntry { const Student* s; unsigned id; };
+    IdEntry* ids = memNewArray<IdEntry>(MEM_SORT, n);
+    for (int i=0;i<n;i++) { ids[i].s = order[i]; ids[i].id = (unsigned)i; }
+    for (int gap=n/2; gap>0; gap/=2) {
+        for (int i=gap;i<n;i++) {
+            IdEntry t = ids[i];
+            int j = i;
+            while (j >= gap && ids[j-gap].s > t.s) { ids[j] = ids[j-gap]; j -= gap; }
+            ids[j] = t;
+        }
+    }
+    unsigned nodes = trie.nodeCount() + 1; // arena indices run 1..nodeCount
+    int* datState = memNewArray<int>(MEM_SORT, nodes + 1);
+    unsigned* queue = memNewArray<unsigned>(MEM_SORT, nodes + 1);
+    postCap = (unsigned)n;
+    postings = memNewArray<unsigned>(MEM_INDEX, postCap);
+    grow(64);
+    check[0] = 0x7fffffff; // root: occupied, child of nobody
+    unsigned qh = 0, qt = 0, postPos = 0;
+    used = 1;
+    int nextFree = 1;
+    datState[trie.root()] = 0;
+    queue[qt++] = trie.root();
+    // breadth-first, so each state's children are placed while the free
+    // slots near nextFree are still dense
+    while (qh < qt) {
+        unsigned ti = queue[qh++];
+        const TrieNode& tn = trie.node(ti);
+        int s = datState[ti];
+        postStart[s] = postPos;
+        for (unsigned e = tn.firstStud; e != TRIE_NONE; e = trie.studentEntry(e).next) {
+            const Student* st = trie.studentEntry(e).student;
+            int lo = 0, hi = n-1;
+            while (lo < hi) {
+                int mid = (lo+hi)/2;
+                if (ids[mid].s < st) lo = mid+1; else hi = mid;
+            }
+            if (n > 0 && ids[lo].s == st) postings[postPos++] = ids[lo].id;
+        }
+        postCount[s] = postPos - postStart[s];
+        if (!tn.occupancy) { base[s] = DAT_NO_BASE; continue; }
+        // smallest base whose target slots are all free
+        while (nextFree < (int)states && check[nextFree] != -1) nextFree++;
+        int b = nextFree - (__builtin_ctz(tn.occupancy) + 1);
+        if (b < 0) b = 0;
+        for (;;) {
+            grow((unsigned)(b + TRIE_ALPHABET + 1));
+            bool ok = true;
+            for (unsigned occ = tn.occupancy; occ && ok; occ &= occ-1)
+                if (check[b + __builtin_ctz(occ) + 1] != -1) ok = false;
+            if (ok) break;
+            b++;
+        }
+        base[s] = b;
+        for (unsigned occ = tn.occupancy; occ; occ &= occ-1) {
+            int c = __builtin_ctz(occ);
+            int t = b + c + 1;
+            check[t] = s;
+            if ((unsigned)t >= used) used = t + 1;
+            datState[tn.children[c]] = t;
+            queue[qt++] = tn.children[c];
+        }
+    }
+    npostings = postPos; // students missing from order get no posting
+    memDeleteArray(MEM_SORT, datState, nodes + 1);
+    memDeleteArray(MEM_SORT, queue, nodes + 1);
+    memDeleteArray(MEM_SORT, ids, n);
 }
+
+// ids are positions in the trie's sorted order
+void build(const NameTrie& trie) {
+    int n = 0;
+    trie.forEachSorted([&](Student*) { n++; });
+    Student** order = memNewArray<Student*>(MEM_SORT, n);
+    trie.collectInto(order, n);
+    build(trie, order, n);
+    memDeleteArray(MEM_SORT, order, n);
 }
-if (lo < j) quickSortRoll(arr, lo, j);
-if (i < hi) quickSortRoll(arr, i, hi);
+
+// ids are positions in exportArray() order, i.e. in exportRecords() files
+void build(Course& c) {
+    int n = c.size();
+    Student** arr = c.exportArray();
+    NameTrie trie(n);
+    for (int i=0;i<n;i++) trie.insert(arr[i]);
+    build(trie, arr, n);
+    releaseStudentArray(arr, n);
 }
 
-/* quicksort by marks component */
-void quickSortMarks(Student** arr, int lo, int hi, MarkComponent mc) {
-if (lo >= hi) return;
-double pivotVal = getComponent(arr[(lo+hi)/2], mc);
-int i = lo, j = hi;
-while (i <= j) {
-while (getComponent(arr[i], mc) < pivotVal) i++;
-while (getComponent(arr[j], mc) > pivotVal) j--;
-if (i <= j) {
-quickSwap(arr, i, j);
-i++; j--;
+// record ids of students named exactly name: writes up to cap, returns total
+int lookup(const char* name, unsigned* out, int cap) const {
+    int s = walk(name);
+    if (s < 0) return 0;
+    int k = (int)postCount[s];
+    for (int i=0;i<k && i<cap;i++) out[i] = postings[postStart[s]+i];
+    return k;
 }
+
+bool contains(const char* name) const {
+    int s = walk(name);
+    return s >= 0 && postCount[s] > 0;
 }
-if (lo < j) quickSortMarks(arr, lo, j, mc);
-if (i < hi) quickSortMarks(arr, i, hi, mc);
+
+// call fn(id) for every name starting with prefix, in sorted name order
+template<class Fn> void forEachWithPrefix(const char* prefix, Fn fn) const {
+    int s = walk(prefix);
+    if (s >= 0) emitSubtree(s, fn);
 }
 
-/* -------------------------
-Trie for name sorting
+unsigned stateCount() const { return used; }
 
-* store pointers to Student at terminal nodes
-* traverse trie in lexicographic order
-  ------------------------- */
+void save(const char* path) const {
+    FILE* f = fopen(path, "wb");
+    if (!f) throw FileIOException();
+    DatHeader h;
+    memcpy(h.magic, "STDATRI1", 8);
+    h.states = used;
+    h.postings = npostings;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+        && fwrite(base, sizeof(int), used, f) == used
+        && fwrite(check, sizeof(int), used, f) == used
+        && fwrite(postStart, sizeof(unsigned), used, f) == used
+        && fwrite(postCount, sizeof(unsigned), used, f) == used
+        && fwrite(postings, sizeof(unsigned), npostings, f) == npostings;
+    if (fclose(f) != 0 || !ok) throw FileIOException();
+}
 
-const int TRIE_ALPHABET = 27; // 'a'..'z' + space as 26
-inline int chIndex(char c) {
-if (c == ' ') return 26;
-c = tolower((unsigned char)c);
-if (c >= 'a' && c <= 'z') return c - 'a';
-return 26; // map anything else to space (safe)
+// map a saved trie read-only; the arrays are used in place. Throws
+// FileIOException unless the header matches the file size, the root has no
+// parent and every posting range lies inside the posting array.
+void load(const char* path) {
+    release();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) throw FileIOException();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DatHeader)) { close(fd); throw FileIOException(); }
+    void* m = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) throw FileIOException();
+    const DatHeader* h = (const DatHeader*)m;
+    size_t need = sizeof(DatHeader) + (size_t)h->states*4*sizeof(int) + (size_t)h->postings*sizeof(unsigned);
+    if (memcmp(h->magic, "STDATRI1", 8) != 0 || need != (size_t)st.st_size) {
+        munmap(m, (size_t)st.st_size);
+        throw FileIOException();
+    }
+    char* p = (char*)m + sizeof(DatHeader);
+    unsigned ns = h->states, np = h->postings;
+    const int* chk = (const int*)p + ns;
+    const unsigned* ps = (const unsigned*)p + 2*(size_t)ns;
+    const unsigned* pc = ps + ns;
+    // step() bounds-checks base/check itself; a root with a parent could
+    // make the state graph cyclic, and postings are indexed unchecked
+    bool ok = ns == 0 ? np == 0 : (chk[0] < 0 || (unsigned)chk[0] >= ns);
+    for (unsigned i=0; ok && i<ns; i++) ok = ps[i] <= np && pc[i] <= np - ps[i];
+    if (!ok) {
+        munmap(m, (size_t)st.st_size);
+        throw FileIOException();
+    }
+    states = used = ns;
+    npostings = np;
+    base = (int*)p;
+    check = base + ns;
+    postStart = (unsigned*)(check + ns);
+    postCount = postStart + ns;
+    postings = postCount + ns;
+    mapped = m;
+    mappedLen = (size_t)st.st_size;
 }
 
-struct TrieNode {
-TrieNode* children[TRIE_ALPHABET];
-Student** students; // dynamic array of pointers (for multiple students with same name)
-int studCount;
-int studCap;
-TrieNode() {
-for (int i=0;i<TRIE_ALPHABET;i++) children[i]=nullptr;
-students = nullptr;
-studCount = 0;
-studCap = 0;
+};
+
+/* -------------------------
+Benchmarks (./assignment --bench [students])
+------------------------- */
+
+double elapsedMs(std::chrono::steady_clock::time_point t0) {
+return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
 }
-~TrieNode() {
-for (int i=0;i<TRIE_ALPHABET;i++) if (children[i]) delete children[i];
-if (students) delete [] students;
+
+/* n students S00000000.. whose totals rise with the roll (all distinct) */
+void addPresortedStudents(Course& course, int n) {
+for (int i=0;i<n;i++) {
+    BTechStudent* s = new BTechStudent();
+    s->setName("Sorted Student");
+    char r[ROLL_MAX];
+    snprintf(r, ROLL_MAX, "S%08d", i);
+    s->setRoll(r);
+    Marks m;
+    m.finalexam = 100.0 * i / n;
+    s->setMarks(m);
+    course += s;
 }
-void addStudent(Student* s) {
-if (studCount == studCap) {
-int newcap = (studCap==0)?4:studCap*2;
-Student** tmp = new Student*[newcap];
-for (int i=0;i<studCount;i++) tmp[i]=students[i];
-if (students) delete [] students;
-students = tmp;
-studCap = newcap;
 }
-students[studCount++] = s;
+
+/* per-object loops vs. the column kernels, for totals and full statistics */
+void benchAggregates(int n) {
+const int REPS = 20;
+Course course;
+for (int i=0;i<n;i++) {
+    BTechStudent* s = new BTechStudent();
+    s->setName("Bench Student");
+    char r[ROLL_MAX];
+    snprintf(r, ROLL_MAX, "B%08d", i);
+    s->setRoll(r);
+    Marks m;
+    m.assignment = i % 21; m.midterm = (i*7) % 31; m.lab = (i*3) % 16; m.finalexam = (i*11) % 51;
+    s->setMarks(m);
+    course += s;
 }
-};
+cout << n << " students, " << REPS << " repetitions, cpu kernel: " << simdLevelName(simdLevel()) << "\n";
+double* out = memNewArray<double>(MEM_COLUMNS, n);
+Student** arr = course.exportArray();
+volatile double sink = 0;
 
-class NameTrie {
-private:
-TrieNode* root;
-public:
-NameTrie() { root = new TrieNode(); }
-~NameTrie() { delete root; }
+auto t0 = std::chrono::steady_clock::now();
+for (int r=0;r<REPS;r++) {
+    for (int i=0;i<n;i++) out[i] = arr[i]->totalMarks();
+    sink = sink + out[n-1];
+}
+double loopTotals = elapsedMs(t0);
 
-void insert(Student* s) {
-    const char* name = s->getName();
-    TrieNode* cur = root;
-    int n = strlen(name);
-    for (int i=0;i<n;i++) {
-        int idx = chIndex(name[i]);
-        if (!cur->children[idx]) cur->children[idx] = new TrieNode();
-        cur = cur->children[idx];
+t0 = std::chrono::steady_clock::now();
+for (int r=0;r<REPS;r++) {
+    // what aggregate() replaces: one pass per statistic over the objects
+    for (int c=0;c<=MC_COUNT;c++) {
+        double s = 0, mn = 1e300, mx = -1e300;
+        for (int i=0;i<n;i++) {
+            double v = c < MC_COUNT ? arr[i]->getMarks().at((MarkComponent)c) : arr[i]->totalMarks();
+            s += v;
+            if (v < mn) mn = v;
+            if (v > mx) mx = v;
+        }
+        double mean = s / n, ss = 0;
+        for (int i=0;i<n;i++) {
+            double v = c < MC_COUNT ? arr[i]->getMarks().at((MarkComponent)c) : arr[i]->totalMarks();
+            ss += (v-mean)*(v-mean);
+        }
+        sink = sink + ss + mn + mx;
     }
-    cur->addStudent(s);
 }
+double loopStats = elapsedMs(t0);
+cout << "per-object loop: totals " << loopTotals << " ms, statistics " << loopStats << " ms\n";
 
-// traverse and append to output array
-void traverseCollect(TrieNode* node, Student** out, int &idx) {
-    if (!node) return;
-    // if students at node, append them
-    if (node->studCount > 0) {
-        // append all students in insertion order
-        for (int k=0;k<node->studCount;k++) out[idx++] = node->students[k];
-    }
-    for (int i=0;i<TRIE_ALPHABET;i++) {
-        if (node->children[i]) traverseCollect(node->children[i], out, idx);
+// the kernels at every level this CPU runs, over a copy of the columns
+double* colCopy[MC_COUNT];
+for (int c=0;c<MC_COUNT;c++) {
+    colCopy[c] = memNewArray<double>(MEM_COLUMNS, n);
+    for (int i=0;i<n;i++) colCopy[c][i] = arr[i]->getMarks().at((MarkComponent)c);
+}
+for (int l=SIMD_SCALAR; l<=(int)simdLevel(); l++) {
+    SimdLevel lvl = (SimdLevel)l;
+    t0 = std::chrono::steady_clock::now();
+    for (int r=0;r<REPS;r++) { columnTotals(colCopy, out, n, lvl); sink = sink + out[n-1]; }
+    double kt = elapsedMs(t0);
+    t0 = std::chrono::steady_clock::now();
+    for (int r=0;r<REPS;r++) {
+        for (int c=0;c<MC_COUNT;c++) sink = sink + columnStats(colCopy[c], n, lvl).variance;
+        columnTotals(colCopy, out, n, lvl);
+        sink = sink + columnStats(out, n, lvl).variance;
     }
+    double ks = elapsedMs(t0);
+    cout << simdLevelName(lvl) << " kernels: totals " << kt << " ms, statistics " << ks << " ms\n";
 }
 
-// produce sorted array of size 'count'. Caller must ensure out has capacity count.
-void collectSorted(Student** out, int count) {
-    int idx = 0;
-    traverseCollect(root, out, idx);
-    // idx should be == count
+t0 = std::chrono::steady_clock::now();
+for (int r=0;r<REPS;r++) { course.computeTotals(out); sink = sink + out[n-1]; }
+double apiTotals = elapsedMs(t0);
+t0 = std::chrono::steady_clock::now();
+for (int r=0;r<REPS;r++) sink = sink + course.aggregate().total.variance;
+double apiStats = elapsedMs(t0);
+cout << "Course API: computeTotals " << apiTotals << " ms, aggregate " << apiStats << " ms\n";
+
+// weighted grading: compile-time specialised vs. runtime scheme
+GradingScheme runtime = schemeOf<SchemeExamWeighted>();
+t0 = std::chrono::steady_clock::now();
+for (int r=0;r<REPS;r++) { course.computeTotals<SchemeExamWeighted>(out); sink = sink + out[n-1]; }
+double compiled = elapsedMs(t0);
+t0 = std::chrono::steady_clock::now();
+for (int r=0;r<REPS;r++) { course.computeTotals(runtime, out); sink = sink + out[n-1]; }
+double interpreted = elapsedMs(t0);
+cout << "Weighted scheme: compiled " << compiled << " ms (plain computeTotals " << apiTotals
+     << " ms), runtime " << interpreted << " ms\n";
+
+for (int c=0;c<MC_COUNT;c++) memDeleteArray(MEM_COLUMNS, colCopy[c], n);
+releaseStudentArray(arr, n);
+memDeleteArray(MEM_COLUMNS, out, n);
 }
 
-};
+/* percentile grading of rosters added in ascending total order: the time
+   should grow linearly with the roster */
+void benchGrading(int n) {
+cout << "\nPercentile grading of pre-sorted rosters\n";
+GradeBand bands[] = { {"A", 0.1}, {"B", 0.35}, {"C", 0.7}, {"D", 0.9}, {"F", 1.0} };
+for (int m = n/4 > 0 ? n/4 : 1; ; m *= 2) {
+    if (m > n) m = n;
+    Course course;
+    addPresortedStudents(course, m);
+    course.setGradeCurve(bands, 5, CURVE_PERCENTILE);
+    int dist[5];
+    auto t0 = std::chrono::steady_clock::now();
+    course.gradeDistribution(dist);
+    cout << m << " students: " << elapsedMs(t0) << " ms (A = " << dist[0] << ")\n";
+    if (m == n) break;
+}
+}
 
-/* -------------------------
-Utility to sort by name using trie
-------------------------- */
-Student** sortByNameUsingTrie(Course& c) {
-int n = c.size();
-if (n==0) return nullptr;
-Student** arr = c.exportArray();
-NameTrie trie;
-for (int i=0;i<n;i++) trie.insert(arr[i]);
-Student** out = new Student*[n];
-for (int i=0;i<n;i++) out[i]=nullptr;
-trie.collectSorted(out, n);
-delete [] arr;
-return out;
+/* every name-sort engine on one roster; the trie engines must agree exactly */
+void benchNameSort(int n) {
+Course course;
+unsigned long long x = 0x2545F4914F6CDD1DULL;
+for (int i=0;i<n;i++) {
+    BTechStudent* s = new BTechStudent();
+    char nm[24];
+    int len = 0;
+    for (int w=0;w<2;w++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        int wl = 3 + (int)(x % 7);
+        nm[len++] = (char)('A' + (x >> 8) % 26);
+        for (int k=1;k<wl;k++) nm[len++] = (char)('a' + (x >> (8 + 5*k)) % 26);
+        nm[len++] = ' ';
+    }
+    nm[len-1] = '\0';
+    s->setName(nm);
+    char r[ROLL_MAX];
+    snprintf(r, ROLL_MAX, "N%08d", i);
+    s->setRoll(r);
+    course += s;
+}
+cout << "\nName sort, " << n << " students, " << std::thread::hardware_concurrency() << " hardware threads\n";
+const NameSortEngine engines[] = { NAME_SORT_TRIE, NAME_SORT_BURST, NAME_SORT_MULTIKEY, NAME_SORT_COLLATION };
+const char* labels[] = { "trie", "burstsort", "multikey", "collation" };
+Student** serial = nullptr;
+for (int e=0;e<4;e++) {
+    auto t0 = std::chrono::steady_clock::now();
+    Student** sorted = sortByNameUsingTrie(course, engines[e]);
+    cout << labels[e] << ": " << elapsedMs(t0) << " ms\n";
+    if (engines[e] == NAME_SORT_TRIE) serial = sorted; else releaseStudentArray(sorted, n);
+}
+// parallel trie at several thread counts (0 = every core)
+const int threadCounts[] = { 0, 2, 4, 8 };
+for (int t=0;t<4;t++) {
+    auto t0 = std::chrono::steady_clock::now();
+    Student** sorted = sortByNameUsingTrie(course, NAME_SORT_TRIE_PARALLEL, threadCounts[t]);
+    double ms = elapsedMs(t0);
+    bool same = true;
+    for (int i=0;i<n;i++) if (sorted[i] != serial[i]) same = false;
+    cout << "parallel trie, ";
+    if (threadCounts[t]) cout << threadCounts[t] << " threads"; else cout << "every core";
+    cout << ": " << ms << " ms (matches serial: "
+         << (same ? "yes" : "NO") << ")\n";
+    releaseStudentArray(sorted, n);
+}
+releaseStudentArray(serial, n);
 }
 
 /* -------------------------
@@ -576,10 +5204,54 @@ try {
     cout << "\nSorted by name (Trie):\n";
     Student** nameSorted = sortByNameUsingTrie(course);
     for (int i=0;i<n;i++) nameSorted[i]->print();
+    Student** burstSorted = sortByNameUsingTrie(course, NAME_SORT_BURST);
+    bool sameOrder = true;
+    for (int i=0;i<n;i++) if (burstSorted[i] != nameSorted[i]) sameOrder = false;
+    cout << "Burstsort engine agrees: " << (sameOrder ? "yes" : "no") << "\n";
+    releaseStudentArray(burstSorted, n);
+    Student** parSorted = sortByNameUsingTrie(course, NAME_SORT_TRIE_PARALLEL);
+    sameOrder = true;
+    for (int i=0;i<n;i++) if (parSorted[i] != nameSorted[i]) sameOrder = false;
+    cout << "Parallel trie engine agrees: " << (sameOrder ? "yes" : "no") << "\n";
+    releaseStudentArray(parSorted, n);
+    Student** mkSorted = sortByNameUsingTrie(course, NAME_SORT_MULTIKEY);
+    sameOrder = true;
+    for (int i=0;i<n;i++) if (cmpNames(mkSorted[i]->getName(), nameSorted[i]->getName()) != 0) sameOrder = false;
+    cout << "Multikey quicksort agrees: " << (sameOrder ? "yes" : "no") << "\n";
+    releaseStudentArray(mkSorted, n);
+
+    // fuzzy lookup: misspelt names within two edits
+    cout << "\nFuzzy search for 'Amit Kumr' and 'rahul varma':\n";
+    NameTrie lookupTrie(n);
+    Student** all = course.exportArray();
+    for (int i=0;i<n;i++) lookupTrie.insert(all[i]);
+    releaseStudentArray(all, n);
+    FuzzyMatch fm[3];
+    const char* queries[] = { "Amit Kumr", "rahul varma" };
+    for (int qi=0;qi<2;qi++) {
+        int nf = lookupTrie.fuzzySearch(queries[qi], 2, fm, 3);
+        for (int i=0;i<nf;i++) cout << queries[qi] << " -> " << fm[i].student->getName() << " (distance " << fm[i].distance << ")\n";
+    }
+
+    // UTF-8 names sort on their precomputed collation keys
+    cout << "\nUTF-8 names by collation key:\n";
+    Course intl;
+    const char* intlNames[] = { "Zoë Ångström", "José Müller", "राहुल वर्मा", "Jose Muller" };
+    for (int i=0;i<4;i++) {
+        PhDStudent* ps = new PhDStudent();
+        ps->setName(intlNames[i]);
+        char r[ROLL_MAX];
+        snprintf(r, ROLL_MAX, "23IN%04d", i);
+        ps->setRoll(r);
+        intl += ps;
+    }
+    Student** intlSorted = sortByNameUsingTrie(intl, NAME_SORT_COLLATION);
+    for (int i=0;i<intl.size();i++) cout << intlSorted[i]->getName() << "\n";
+    releaseStudentArray(intlSorted, intl.size());
 
-    delete [] arr;
-    delete [] arr2;
-    delete [] nameSorted;
+    releaseStudentArray(arr, n);
+    releaseStudentArray(arr2, n);
+    releaseStudentArray(nameSorted, n);
 
     // demonstrate exception handling
     try {
@@ -608,13 +5280,350 @@ try {
         cout << "Caught exception while accessing student: " << e.what() << "\n";
     }
 
+    // batched mark updates: one pass for a whole column
+    cout << "\nBatched final-exam update:\n";
+    MarkUpdate ups[] = {
+        {"20CS1001", MC_FINAL, 47},
+        {"19CS0999", MC_FINAL, 48.5},
+        {"0000/NOTFOUND", MC_FINAL, 10},
+    };
+    BatchResult br = course.applyMarkUpdates(ups, 3);
+    cout << "Applied = " << br.applied << ", not found = " << br.notFound << "\n";
+    course("20CS1001").print();
+    // a bad component rejects the whole batch: nothing is written
+    MarkUpdate badUps[] = {
+        {"20CS1001", MC_FINAL, 0},
+        {"20CS1001", (MarkComponent)MC_COUNT, 99},
+    };
+    unsigned long long verBefore = course.mutationVersion();
+    try {
+        course.applyMarkUpdates(badUps, 2);
+    } catch (StudentException &e) {
+        cout << "Caught exception in batch update: " << e.what() << "\n";
+    }
+    cout << "Batch left course unchanged: "
+         << (course.mutationVersion() == verBefore && course("20CS1001").getMarks().finalexam == 47 ? "yes" : "NO") << "\n";
+
+    // cached sorted views: patched instead of re-sorted after small changes
+    cout << "\nCached view by total (after batch):\n";
+    Student* const* byTotal = course.sortedView(SK_TOTAL);
+    for (int i=0;i<course.size();i++) byTotal[i]->print();
+    Marks bumped = course("21EC2001").getMarks();
+    bumped.lab = 20;
+    course("21EC2001").setMarks(bumped);
+    byTotal = course.sortedView(SK_TOTAL);
+    cout << "After raising 21EC2001 lab marks:\n";
+    for (int i=0;i<course.size();i++) byTotal[i]->print();
+    CourseStats vs = course.stats();
+    cout << "View rebuilds = " << vs.viewRebuilds << ", patches = " << vs.viewPatches << "\n";
+
+    // stable sort: equal keys keep their export order on every run
+    cout << "\nStable sort by lab marks:\n";
+    SortScratch scratch;
+    Student** stable = course.exportArray();
+    sortStudents(stable, course.size(), SK_LAB, SORT_STABLE, &scratch);
+    for (int i=0;i<course.size();i++) stable[i]->print();
+    releaseStudentArray(stable, course.size());
+
+    // composite sort: ORDER BY branch, level, total DESC, name
+    cout << "\nSorted by branch, level, total desc, name:\n";
+    SortTerm order[] = {
+        {CF_BRANCH, false}, {CF_LEVEL, false}, {CF_TOTAL, true}, {CF_NAME, false},
+    };
+    Student** multi = course.exportArray();
+    sortComposite(multi, course.size(), order, 4);
+    for (int i=0;i<course.size();i++) multi[i]->print();
+    releaseStudentArray(multi, course.size());
+
+    // names sharing the key prefix are ordered on the full name before later terms
+    {
+        BTechStudent longA, longB;
+        longA.setName("Aaaaaaaa Aaaaaaaaaz");
+        longB.setName("Aaaaaaaa Aaaaaaaaab");
+        Marks ma, mb;
+        ma.finalexam = 10;
+        mb.finalexam = 20;
+        longA.setMarks(ma);
+        longB.setMarks(mb);
+        Student* pair[] = { &longA, &longB };
+        SortTerm byName[] = { {CF_NAME, false}, {CF_TOTAL, false} };
+        sortComposite(pair, 2, byName, 2);
+        cout << "ORDER BY name, total: " << pair[0]->getName() << ", " << pair[1]->getName() << "\n";
+    }
+
+    // external merge sort over a record file (tiny budget forces several runs)
+    cout << "\nExternal sort of exported records by total:\n";
+    exportRecords(course, "students.rec");
+    ExternalSorter ext(2*sizeof(ArchivedStudent), SK_TOTAL);
+    long long sorted = ext.sort("students.rec", "students.sorted.rec");
+    RecordReader rd("students.sorted.rec");
+    StudentRecord rec;
+    ArchivedStudent as;
+    while (rd.next(rec)) { as.load(rec); as.print(); }
+    cout << sorted << " records sorted\n";
+    remove("students.rec");
+    remove("students.sorted.rec");
+
+    // static double-array trie: saved once, mapped back without rebuilding
+    cout << "\nDouble-array name dictionary (mmap'd):\n";
+    {
+        DoubleArrayTrie built;
+        built.build(course);
+        built.save("names.dat");
+        built.save("names.bad.dat");
+    }
+    DoubleArrayTrie dict;
+    dict.load("names.dat");
+    Student** byId = course.exportArray(); // ids index the export order
+    unsigned hits[4];
+    int nh = dict.lookup("Rahul Verma", hits, 4);
+    for (int i=0;i<nh && i<4;i++) cout << "Exact: " << byId[hits[i]]->getRoll() << "\n";
+    dict.forEachWithPrefix("S", [&](unsigned id) { cout << "Prefix S: " << byId[id]->getName() << "\n"; });
+    cout << "Contains 'Amit': " << (dict.contains("Amit") ? "yes" : "no") << "\n";
+    releaseStudentArray(byId, course.size());
+    remove("names.dat");
+    // a corrupted or truncated dictionary is rejected before any lookup
+    FILE* df = fopen("names.bad.dat", "r+b");
+    DatHeader dh;
+    if (df && fread(&dh, sizeof(dh), 1, df) == 1) {
+        unsigned badStart = dh.postings + 1; // postStart[0] past the postings
+        fseek(df, (long)(sizeof(DatHeader) + 2*dh.states*sizeof(int)), SEEK_SET);
+        fwrite(&badStart, sizeof(badStart), 1, df);
+    }
+    if (df) fclose(df);
+    for (int pass=0; pass<2; pass++) {
+        if (pass == 1) truncate("names.bad.dat", (off_t)sizeof(DatHeader) + 8);
+        try {
+            DoubleArrayTrie bad;
+            bad.load("names.bad.dat");
+            cout << (pass ? "Truncated" : "Corrupted") << " dictionary loaded: NOT rejected\n";
+        } catch (StudentException &e) {
+            cout << (pass ? "Truncated" : "Corrupted") << " dictionary rejected: " << e.what() << "\n";
+        }
+    }
+    remove("names.bad.dat");
+
+    // ordered roll index: range and prefix scans
+    cout << "\nRolls with prefix 2 (B+tree range scan):\n";
+    RollRange rr = course.rangeByRollPrefix("2");
+    while (Student* rs = rr.next()) cout << rs->getRoll() << "\n";
+    cout << "Rolls between 19CS0000 and 20CS9999:\n";
+    rr = course.rangeByRoll("19CS0000", "20CS9999");
+    while (Student* rs = rr.next()) cout << rs->getRoll() << "\n";
+
+    // roll filter: absent rolls are rejected without a list scan
+    cout << "\nRoll filter:\n";
+    course.enableRollFilter();
+    for (int i=0;i<3;i++) {
+        try {
+            course("0000/NOTFOUND");
+        } catch (RollNotFoundException &e) {}
+    }
+    CourseStats st = course.stats();
+    cout << "Filter queries = " << st.filterQueries << ", rejected = " << st.filterNegatives
+         << ", observed FPR = " << st.filterObservedFpr
+         << ", estimated FPR = " << st.filterEstimatedFpr << "\n";
+
+    // handle-based removal
+    cout << "\nHandle-based removal:\n";
+    BTechStudent* s6 = new BTechStudent();
+    s6->setName("Neha Gupta");
+    s6->setRoll("22CS1100");
+    StudentHandle h6 = (course += s6);
+    cout << "Added " << course.get(h6)->getRoll() << ", size = " << course.size() << "\n";
+    course.remove(h6);
+    cout << "Removed by handle, size = " << course.size()
+         << ", stale handle resolves to " << (course.get(h6) ? "student" : "nullptr") << "\n";
+
+    // snapshot reads: an open reader keeps seeing the version it pinned
+    cout << "\nSnapshot reads:\n";
+    course.enableSnapshots();
+    {
+        SnapshotReader before(course.snapshots());
+        Marks late = course("20CS1001").getMarks();
+        late.assignment = 19;
+        course("20CS1001").setMarks(late);
+        SnapshotReader after(course.snapshots());
+        cout << "Pinned reader sees A=" << before.find("20CS1001")->marks.assignment
+             << ", new reader sees A=" << after.find("20CS1001")->marks.assignment << "\n";
+    }
+    course.printAll();
+
+    // marks history: time-travel reads after a regrade
+    cout << "\nMarks history:\n";
+    course.enableHistory(30LL*24*3600*1000000); // keep 30 days
+    Timestamp beforeRegrade = systemMicros();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    Marks regrade = course("19CS0999").getMarks();
+    regrade.midterm = 27;
+    course("19CS0999").setMarks(regrade);
+    cout << "19CS0999 midterm now = " << course("19CS0999").getMarks().midterm
+         << ", before regrade = " << course.asOf(beforeRegrade)("19CS0999").midterm << "\n";
+
+    // concurrent backing: parallel intake threads, then an ordered walk
+    cout << "\nConcurrent skiplist course (4 intake threads):\n";
+    {
+        ConcurrentCourse cc;
+        std::thread intake[4];
+        for (int t=0;t<4;t++) {
+            intake[t] = std::thread([&cc, t]() {
+                for (int i=0;i<250;i++) {
+                    char r[ROLL_MAX];
+                    snprintf(r, sizeof(r), "23CS%d%03d", t, i);
+                    BTechStudent* st = new BTechStudent();
+                    st->setName("Intake Student");
+                    st->setRoll(r);
+                    cc += st;
+                }
+            });
+        }
+        for (int t=0;t<4;t++) intake[t].join();
+        {
+            EpochGuard pin; // exported pointers stay valid while pinned
+            Student** ordered = memNewArray<Student*>(MEM_EXPORT, cc.size());
+            int got = cc.exportSorted(ordered, cc.size());
+            bool inOrder = true;
+            for (int i=1;i<got;i++) if (strcmp(ordered[i-1]->getRoll(), ordered[i]->getRoll()) > 0) inOrder = false;
+            cout << "Inserted " << cc.size() << " students, first " << ordered[0]->getRoll()
+                 << ", last " << ordered[got-1]->getRoll() << ", in order: " << (inOrder ? "yes" : "no") << "\n";
+            releaseStudentArray(ordered, cc.size());
+        }
+        // removals on two threads while two others look students up
+        long long nodeBytes = memStats().sub[MEM_NODES].bytes;
+        std::atomic<int> wrong(0);
+        std::thread churn[4];
+        for (int t=0;t<4;t++) {
+            churn[t] = std::thread([&cc, &wrong, t]() {
+                for (int i=0;i<250;i++) {
+                    char r[ROLL_MAX];
+                    snprintf(r, sizeof(r), "23CS%d%03d", t % 2, i);
+                    if (t < 2) cc.removeByRoll(r);
+                    else cc.withStudent(r, [&](Student* st) { if (strcmp(st->getRoll(), r) != 0) wrong++; });
+                }
+            });
+        }
+        for (int t=0;t<4;t++) churn[t].join();
+        cc.collect();
+        cout << "After removing 500: " << cc.size() << " left, pending nodes " << cc.pendingNodes()
+             << ", node memory " << nodeBytes << " B -> " << memStats().sub[MEM_NODES].bytes << " B"
+             << ", wrong lookups " << wrong.load() << "\n";
+        ConcurrentCourse::Pinned first = cc.findByRoll("23CS2000");
+        if (first) cout << "Pinned lookup: " << first->getRoll() << "\n";
+    }
+
+    // weighted grading schemes
+    cout << "\nExam-weighted totals (out of 100):\n";
+    double* weighted = new double[course.size()];
+    Student** weightedWho = new Student*[course.size()];
+    int nw = course.computeTotals<SchemeExamWeighted>(weighted, weightedWho);
+    for (int i=0;i<nw;i++) cout << weightedWho[i]->getRoll() << ": " << weighted[i] << "\n";
+    Marks full;
+    full.assignment = 20; full.midterm = 30; full.lab = 15; full.finalexam = 50;
+    cout << "Full marks score: " << schemeTotal<SchemeExamWeighted>(full) << " (runtime scheme: "
+         << schemeOf<SchemeExamWeighted>().total(full) << ")\n";
+    GradingScheme bestExam = schemeOf<SchemeBestExam>(); // runtime form of the same rules
+    bestExam.totalCap = 100;
+    course.computeTotals(bestExam, weighted);
+    cout << "Best-of-exams, capped at 100: " << weighted[0] << " for " << weightedWho[0]->getRoll() << "\n";
+    delete [] weighted;
+    delete [] weightedWho;
+
+    // relative grading: top third A, next third B, rest C
+    cout << "\nLetter grades (percentile curve):\n";
+    GradeBand curve[] = { {"A", 0.33}, {"B", 0.66}, {"C", 1.0} };
+    course.setGradeCurve(curve, 3, CURVE_PERCENTILE);
+    Student* const* byRoll = course.sortedView(SK_ROLL);
+    for (int i=0;i<course.size();i++)
+        cout << byRoll[i]->getRoll() << ": " << course.letterGrade(byRoll[i]->getRoll()) << "\n";
+    int dist[3];
+    course.gradeDistribution(dist);
+    cout << "A/B/C = " << dist[0] << "/" << dist[1] << "/" << dist[2] << "\n";
+    {
+        // a large roster added in ascending total order grades in linear time
+        const int NS = 20000;
+        Course presorted;
+        addPresortedStudents(presorted, NS);
+        GradeBand quarters[] = { {"A", 0.25}, {"B", 0.5}, {"C", 0.75}, {"D", 1.0} };
+        presorted.setGradeCurve(quarters, 4, CURVE_PERCENTILE);
+        int qd[4];
+        presorted.gradeDistribution(qd);
+        cout << "Pre-sorted roster of " << NS << ": A/B/C/D = " << qd[0] << "/" << qd[1] << "/" << qd[2] << "/" << qd[3]
+             << ", top " << presorted.letterGrade("S00019999") << ", bottom " << presorted.letterGrade("S00000000") << "\n";
+    }
+
+    // incrementally maintained distributions
+    cout << "\nTotal marks histogram (bins of 5, non-empty bins):\n";
+    course.enableHistograms(5);
+    MarksHistogram th = course.histogram(HIST_TOTAL);
+    for (int i=0;i<th.nbins;i++)
+        if (th.counts[i]) cout << "[" << i*th.binWidth << ", " << (i+1)*th.binWidth << "): " << th.counts[i] << "\n";
+    MarksHistogram cseFinal = course.histogram(MC_FINAL, BR_CSE);
+    cout << "CSE students with final >= 45: ";
+    int high = cseFinal.overflow;
+    for (int i=45/cseFinal.binWidth;i<cseFinal.nbins;i++) high += cseFinal.counts[i];
+    cout << high << " of " << cseFinal.students << "\n";
+    {
+        // a NaN mark is counted as overflow; a student with no group is skipped
+        MarksHistograms edge(5);
+        BTechStudent nanMarks, noGroup;
+        Marks nm;
+        nm.finalexam = NAN;
+        nanMarks.setMarks(nm);
+        noGroup.setLevel(HIST_LEVELS);
+        edge.add(&nanMarks);
+        edge.add(&noGroup);
+        MarksHistogram ef = edge.read(MC_FINAL);
+        cout << "NaN final: overflow " << ef.overflow << " of " << ef.students << " counted\n";
+        edge.remove(&nanMarks);
+        edge.remove(&noGroup);
+    }
+
+    // roster-wide statistics from the dense marks columns
+    cout << "\nAggregates (" << simdLevelName(simdLevel()) << " kernels):\n";
+    MarksAggregate ag = course.aggregate();
+    const char* compNames[MC_COUNT] = { "Assignment", "Midterm", "Lab", "Final" };
+    for (int c=0;c<MC_COUNT;c++) {
+        cout << compNames[c] << ": mean " << ag.component[c].mean << ", min " << ag.component[c].min
+             << ", max " << ag.component[c].max << ", variance " << ag.component[c].variance << "\n";
+    }
+    cout << "Total: sum " << ag.total.sum << ", mean " << ag.total.mean << ", variance " << ag.total.variance << "\n";
+
+    // streaming quantile sketches: one per branch from the archive, then merged
+    cout << "\nQuantile sketches from an archive (per branch, merged):\n";
+    exportRecords(course, "sketch.rec");
+    MarksSketch branchSketch[HIST_BRANCHES];
+    for (int b=0;b<HIST_BRANCHES;b++) {
+        RecordReader sr("sketch.rec");
+        branchSketch[b].addRecords(sr, b);
+    }
+    MarksSketch allSketch;
+    for (int b=0;b<HIST_BRANCHES;b++) allSketch.merge(branchSketch[b]);
+    cout << "Students: " << allSketch.size() << ", median total " << allSketch.totalQuantile(0.5)
+         << ", 90th percentile final " << allSketch.quantile(MC_FINAL, 0.9) << "\n";
+    cout << "CSE median total " << branchSketch[BR_CSE].totalQuantile(0.5) << "\n";
+    branchSketch[BR_CSE].merge(branchSketch[BR_CSE]); // every value counted twice
+    cout << "CSE self-merged: " << branchSketch[BR_CSE].size() << " values, median total "
+         << branchSketch[BR_CSE].totalQuantile(0.5) << "\n";
+    remove("sketch.rec");
+
+    cout << "\nMemory usage:\n";
+    printMemStats();
+
 } catch (std::exception &e) {
     cout << "Unhandled exception: " << e.what() << "\n";
 }
 
 }
 
-int main() {
+int main(int argc, char** argv) {
+if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+    int n = argc > 2 ? atoi(argv[2]) : 1000000;
+    if (n < 1) n = 1;
+    benchAggregates(n);
+    benchGrading(n);
+    benchNameSort(n);
+    return 0;
+}
 cout << "OOPD Assignment demo\n";
 demo();
 cout << "\nDemo finished.\n";